@@ -0,0 +1,147 @@
+/******************************************************************************
+ * The MIT License
+ *
+ * Copyright (c) 2026 Technik Gegg
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *****************************************************************************/
+
+/**
+ * @file I2CRegisterMap.cpp
+ * @brief Cached view of the 8-bit register space of an I2C device.
+ */
+
+#include "I2CRegisterMap.h"
+
+I2CRegisterMap::I2CRegisterMap(SoftWire &bus, uint8_t addr, uint8_t blockSize)
+    : bus(bus), addr(addr), block_size(blockSize)
+{
+    memset(valid_map, 0, sizeof(valid_map));
+    memset(volatile_map, 0, sizeof(volatile_map));
+    memset(sensitive_map, 0, sizeof(sensitive_map));
+}
+
+void I2CRegisterMap::mark(uint32_t *map, uint8_t first, uint8_t last, bool state)
+{
+    for (uint16_t reg = first; reg <= last; reg++)
+    {
+        if (state)
+            map[reg >> 5] |= (1UL << (reg & 31));
+        else
+            map[reg >> 5] &= ~(1UL << (reg & 31));
+    }
+}
+
+void I2CRegisterMap::setVolatile(uint8_t first, uint8_t last, bool isVolatile)
+{
+    mark(volatile_map, first, last, isVolatile);
+    if (isVolatile)
+        mark(valid_map, first, last, false);
+}
+
+void I2CRegisterMap::setReadSensitive(uint8_t first, uint8_t last, bool isSensitive)
+{
+    mark(sensitive_map, first, last, isSensitive);
+    setVolatile(first, last, isSensitive);
+}
+
+uint8_t I2CRegisterMap::fetch(uint8_t first, uint8_t last)
+{
+    uint8_t stat = bus.readRegister(addr, first, &cache[first], last - first + 1);
+    if (stat != I2C_OK)
+        return stat;
+    for (uint16_t reg = first; reg <= last; reg++)
+    {
+        if (!test(volatile_map, reg))
+            valid_map[reg >> 5] |= (1UL << (reg & 31));
+    }
+    return I2C_OK;
+}
+
+uint8_t I2CRegisterMap::read(uint8_t reg, uint8_t &value)
+{
+    if (test(valid_map, reg))
+    {
+        value = cache[reg];
+        return I2C_OK;
+    }
+    // volatile registers are read on their own, others prefetch the aligned
+    // block around them, up to the registers that are cached already or
+    // must not be read implicitly
+    uint8_t first = reg;
+    uint8_t last = reg;
+    if (prefetchable(reg))
+    {
+        uint8_t block_first = reg & ~(block_size - 1);
+        uint8_t block_last = block_first + block_size - 1;
+        while (first > block_first && prefetchable(first - 1))
+            first--;
+        while (last < block_last && prefetchable(last + 1))
+            last++;
+    }
+    uint8_t stat = fetch(first, last);
+    value = cache[reg];
+    return stat;
+}
+
+uint8_t I2CRegisterMap::read(uint8_t reg)
+{
+    uint8_t value;
+    if (read(reg, value) != I2C_OK)
+        return 0;
+    return value;
+}
+
+uint8_t I2CRegisterMap::read(uint8_t first, uint8_t *values, uint8_t count)
+{
+    for (uint8_t i = 0; i < count; i++)
+    {
+        uint8_t stat = read(first + i, values[i]);
+        if (stat != I2C_OK)
+            return stat;
+    }
+    return I2C_OK;
+}
+
+uint8_t I2CRegisterMap::write(uint8_t reg, uint8_t value)
+{
+    uint8_t stat = bus.writeRegister(addr, reg, &value, 1);
+    if (stat != I2C_OK)
+    {
+        // the device state is unknown now
+        invalidate(reg, reg);
+        return stat;
+    }
+    cache[reg] = value;
+    if (!test(volatile_map, reg))
+        valid_map[reg >> 5] |= (1UL << (reg & 31));
+    return I2C_OK;
+}
+
+void I2CRegisterMap::invalidate(uint8_t first, uint8_t last)
+{
+    mark(valid_map, first, last, false);
+}
+
+void I2CRegisterMap::invalidateAll()
+{
+    memset(valid_map, 0, sizeof(valid_map));
+}
@@ -0,0 +1,121 @@
+/******************************************************************************
+ * The MIT License
+ *
+ * Copyright (c) 2026 Technik Gegg
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *****************************************************************************/
+
+/**
+ * @file I2CRegisterMap.h
+ * @brief Cached view of the 8-bit register space of an I2C device.
+ */
+
+/*
+ * Reading a register which isn't cached yet fetches the uncached registers of
+ * the aligned block around it in one transfer, relying on the register
+ * address auto increment most devices provide. Registers can be marked as
+ * - volatile: never served from the cache and always read on their own
+ *   (i.e. status or data registers)
+ * - read sensitive: reading has side effects (i.e. clear-on-read flags or
+ *   FIFO data), so they're never prefetched, only read on explicit request
+ * Writes go straight through to the device and update the cache.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "SoftWire.h"
+
+#define I2C_REGMAP_SIZE     256
+
+class I2CRegisterMap {
+private:
+    SoftWire &bus;
+    uint8_t addr;
+    uint8_t block_size;
+    uint8_t cache[I2C_REGMAP_SIZE];
+    uint32_t valid_map[I2C_REGMAP_SIZE / 32];
+    uint32_t volatile_map[I2C_REGMAP_SIZE / 32];
+    uint32_t sensitive_map[I2C_REGMAP_SIZE / 32];
+
+    static bool test(const uint32_t *map, uint8_t reg) { return map[reg >> 5] & (1UL << (reg & 31)); }
+
+    /*
+     * True if reg can be read along with its neighbours: not cached yet,
+     * neither volatile nor read sensitive
+     */
+    bool prefetchable(uint8_t reg) const
+    {
+        return !test(valid_map, reg) && !test(volatile_map, reg) && !test(sensitive_map, reg);
+    }
+    static void mark(uint32_t *map, uint8_t first, uint8_t last, bool state);
+
+    /*
+     * Reads the registers in [first, last] into the cache
+     */
+    uint8_t fetch(uint8_t first, uint8_t last);
+
+public:
+    /*
+     * blockSize is the prefetch granularity and must be a power of two
+     * (up to 128).
+     */
+    I2CRegisterMap(SoftWire &bus, uint8_t addr, uint8_t blockSize = 16);
+
+    /*
+     * Marks registers as volatile, which are always read from the device
+     */
+    void setVolatile(uint8_t first, uint8_t last, bool isVolatile = true);
+
+    /*
+     * Marks registers whose read has side effects. They're implicitly
+     * volatile and never included in a prefetch.
+     */
+    void setReadSensitive(uint8_t first, uint8_t last, bool isSensitive = true);
+
+    /*
+     * Reads a register, from the cache if possible.
+     * Returns the bus status.
+     */
+    uint8_t read(uint8_t reg, uint8_t &value);
+
+    /*
+     * Reads a register, returns 0 on error
+     */
+    uint8_t read(uint8_t reg);
+
+    /*
+     * Reads a range of registers, fetching only the uncached blocks
+     */
+    uint8_t read(uint8_t first, uint8_t *values, uint8_t count);
+
+    /*
+     * Writes a register and updates the cache
+     */
+    uint8_t write(uint8_t reg, uint8_t value);
+
+    /*
+     * Drops cached values, i.e. after a device reset
+     */
+    void invalidate(uint8_t first, uint8_t last);
+    void invalidateAll();
+};
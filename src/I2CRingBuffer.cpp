@@ -0,0 +1,84 @@
+/******************************************************************************
+ * The MIT License
+ *
+ * Copyright (c) 2026 Technik Gegg
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *****************************************************************************/
+
+/**
+ * @file I2CRingBuffer.cpp
+ * @brief Lock-free single-producer / single-consumer ring buffer of fixed
+ *        size samples.
+ */
+
+#include <string.h>
+#include "I2CRingBuffer.h"
+
+I2CRingBuffer::I2CRingBuffer(uint8_t *storage, uint16_t capacity, uint8_t sampleSize)
+    : storage(storage), mask(capacity - 1), sample_size(sampleSize), head(0), tail(0)
+{
+}
+
+uint16_t I2CRingBuffer::available() const
+{
+    return (uint16_t)(head.load(std::memory_order_acquire) - tail.load(std::memory_order_relaxed));
+}
+
+uint16_t I2CRingBuffer::space() const
+{
+    return (mask + 1) - (uint16_t)(head.load(std::memory_order_relaxed) - tail.load(std::memory_order_acquire));
+}
+
+bool I2CRingBuffer::pop(uint8_t *sample)
+{
+    uint16_t t = tail.load(std::memory_order_relaxed);
+    if (head.load(std::memory_order_acquire) == t)
+        return false;
+    memcpy(sample, &storage[(t & mask) * sample_size], sample_size);
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+}
+
+bool I2CRingBuffer::push(const uint8_t *sample)
+{
+    uint16_t count;
+    uint8_t *ptr = writeSpan(count);
+    if (count == 0)
+        return false;
+    memcpy(ptr, sample, sample_size);
+    commit(1);
+    return true;
+}
+
+uint8_t *I2CRingBuffer::writeSpan(uint16_t &count)
+{
+    uint16_t h = head.load(std::memory_order_relaxed);
+    uint16_t free_cnt = space();
+    uint16_t to_end = (mask + 1) - (h & mask);
+    count = (free_cnt < to_end) ? free_cnt : to_end;
+    return &storage[(h & mask) * sample_size];
+}
+
+void I2CRingBuffer::commit(uint16_t count)
+{
+    head.store(head.load(std::memory_order_relaxed) + count, std::memory_order_release);
+}
@@ -0,0 +1,92 @@
+/******************************************************************************
+ * The MIT License
+ *
+ * Copyright (c) 2026 Technik Gegg
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *****************************************************************************/
+
+/**
+ * @file I2CRingBuffer.h
+ * @brief Lock-free single-producer / single-consumer ring buffer of fixed
+ *        size samples.
+ */
+
+/*
+ * The producer and the consumer may run in different contexts without any
+ * locking, as long as there's only one of each. The ring doesn't depend on
+ * the Arduino framework, so it's shared by the FIFO drain (SoftWireFifo.h)
+ * and the sniffer decoder (I2CSniffer.h), which is also built on a host.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * @brief Lock-free SPSC ring buffer of fixed size samples.
+ *        The capacity (in samples) must be a power of two.
+ */
+class I2CRingBuffer {
+private:
+    uint8_t *storage;
+    uint16_t mask;
+    uint8_t sample_size;
+    std::atomic<uint16_t> head;     // next sample to write, owned by the producer
+    std::atomic<uint16_t> tail;     // next sample to read, owned by the consumer
+
+public:
+    /*
+     * The storage must hold capacity * sampleSize bytes
+     */
+    I2CRingBuffer(uint8_t *storage, uint16_t capacity, uint8_t sampleSize);
+
+    /*
+     * Number of samples ready to be read
+     */
+    uint16_t available() const;
+
+    /*
+     * Number of samples that can still be written
+     */
+    uint16_t space() const;
+
+    /*
+     * Copies one sample out of the buffer. Returns false if empty.
+     */
+    bool pop(uint8_t *sample);
+
+    /*
+     * Copies one sample into the buffer. Returns false if full.
+     */
+    bool push(const uint8_t *sample);
+
+    /*
+     * Producer side zero-copy access: returns the write position and the
+     * number of samples that can be stored there without wrapping around.
+     * Samples written have to be published with commit().
+     */
+    uint8_t *writeSpan(uint16_t &count);
+    void commit(uint16_t count);
+
+    uint8_t sampleSize() const { return sample_size; }
+};
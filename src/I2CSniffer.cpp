@@ -0,0 +1,119 @@
+/******************************************************************************
+ * The MIT License
+ *
+ * Copyright (c) 2026 Technik Gegg
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *****************************************************************************/
+
+/**
+ * @file I2CSniffer.cpp
+ * @brief Decoder for passively monitoring traffic of other bus masters.
+ */
+
+#include "I2CSniffer.h"
+
+I2CSnifferDecoder::I2CSnifferDecoder(i2c_sniff_record *storage, uint16_t capacity)
+    : ring((uint8_t*)storage, capacity, sizeof(i2c_sniff_record)), overflow_cnt(0), decoded_cnt(0)
+{
+    reset();
+}
+
+void I2CSnifferDecoder::reset()
+{
+    prev_sda = true;
+    prev_scl = true;
+    in_transfer = false;
+}
+
+void I2CSnifferDecoder::finish(uint8_t flags)
+{
+    in_transfer = false;
+    if (!have_addr)
+        return;     // Start immediately followed by Stop/Start
+    current.flags |= flags;
+    decoded_cnt++;
+    if (!ring.push((const uint8_t*)&current))
+        overflow_cnt++;
+}
+
+void I2CSnifferDecoder::feed(bool sda, bool scl)
+{
+    if (scl && prev_scl && sda != prev_sda)
+    {
+        // SDA changing while SCL is high: Start or Stop condition
+        if (!sda)
+        {
+            if (in_transfer)
+                finish(I2C_SNIFF_RSTART);
+            in_transfer = true;
+            have_addr = false;
+            bits = 0;
+            shift = 0;
+            current.flags = 0;
+            current.length = 0;
+        }
+        else if (in_transfer)
+        {
+            finish(0);
+        }
+    }
+    else if (scl && !prev_scl && in_transfer)
+    {
+        // rising edge of SCL: sample the data bit
+        if (bits < 8)
+        {
+            shift = (shift << 1) | sda;
+            bits++;
+        }
+        else
+        {
+            // ACK bit
+            bool nack = sda;
+            bits = 0;
+            if (!have_addr)
+            {
+                have_addr = true;
+                current.addr = shift >> 1;
+                if (shift & 1)
+                    current.flags |= I2C_SNIFF_READ;
+            }
+            else if (current.length < I2C_SNIFF_MAX_DATA)
+            {
+                current.data[current.length++] = shift;
+            }
+            else
+            {
+                current.flags |= I2C_SNIFF_TRUNCATED;
+            }
+            if (nack)
+                current.flags |= I2C_SNIFF_NACK;
+            shift = 0;
+        }
+    }
+    prev_sda = sda;
+    prev_scl = scl;
+}
+
+bool I2CSnifferDecoder::read(i2c_sniff_record &record)
+{
+    return ring.pop((uint8_t*)&record);
+}
@@ -0,0 +1,124 @@
+/******************************************************************************
+ * The MIT License
+ *
+ * Copyright (c) 2026 Technik Gegg
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *****************************************************************************/
+
+/**
+ * @file I2CSniffer.h
+ * @brief Decoder for passively monitoring traffic of other bus masters.
+ */
+
+/*
+ * The decoder is fed with samples of SDA and SCL and turns them into a ring
+ * buffer of transfer records. It doesn't depend on the Arduino framework, so
+ * it can be tested on a host by feeding recorded edge streams. On the target,
+ * SoftWire::sniff() polls the bus lines and feeds the decoder.
+ *
+ * The decoder (producer) and the code reading the records (consumer) may run
+ * in different contexts.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "I2CRingBuffer.h"
+
+#ifndef I2C_SNIFF_MAX_DATA
+#define I2C_SNIFF_MAX_DATA      32
+#endif
+
+#define I2C_SNIFF_READ          0x01    /**< read transfer */
+#define I2C_SNIFF_NACK          0x02    /**< address or last data byte not ACKed */
+#define I2C_SNIFF_RSTART        0x04    /**< ended with a repeated start */
+#define I2C_SNIFF_TRUNCATED     0x08    /**< more than I2C_SNIFF_MAX_DATA bytes */
+
+/**
+ * @brief A decoded transfer (from Start to Stop or Repeated Start)
+ */
+typedef struct i2c_sniff_record {
+    uint8_t     addr;                       /**< 7 bit address */
+    uint8_t     flags;                      /**< Bitwise OR of I2C_SNIFF_xxx */
+    uint8_t     length;                     /**< Number of data bytes stored */
+    uint8_t     data[I2C_SNIFF_MAX_DATA];   /**< Data bytes */
+} i2c_sniff_record;
+
+// the records are stored as samples of an I2CRingBuffer
+static_assert(sizeof(i2c_sniff_record) <= 255, "I2C_SNIFF_MAX_DATA too large");
+
+class I2CSnifferDecoder {
+private:
+    I2CRingBuffer ring;             // decoder produces, reader consumes
+    uint32_t overflow_cnt;
+    uint32_t decoded_cnt;
+
+    bool prev_sda;
+    bool prev_scl;
+    bool in_transfer;
+    bool have_addr;
+    uint8_t bits;
+    uint8_t shift;
+    i2c_sniff_record current;
+
+    /*
+     * Pushes the current record to the ring buffer
+     */
+    void finish(uint8_t flags);
+
+public:
+    /*
+     * The storage must hold capacity records, capacity being a power of two
+     */
+    I2CSnifferDecoder(i2c_sniff_record *storage, uint16_t capacity);
+
+    /*
+     * Feeds one sample of the bus lines. Samples have to be taken often
+     * enough to see each SCL and SDA level change.
+     */
+    void feed(bool sda, bool scl);
+
+    /*
+     * Copies the oldest record. Returns false if there's none.
+     */
+    bool read(i2c_sniff_record &record);
+
+    /*
+     * Number of records waiting to be read
+     */
+    uint16_t available() const { return ring.available(); }
+
+    /*
+     * Number of records dropped because the ring buffer was full
+     */
+    uint32_t overflows() const { return overflow_cnt; }
+
+    /*
+     * Number of transfers decoded so far (including dropped ones)
+     */
+    uint32_t decoded() const { return decoded_cnt; }
+
+    /*
+     * Resets the decoder state (not the ring buffer)
+     */
+    void reset();
+};
@@ -49,6 +49,7 @@
 /*
  * Ported to Arduino Core STM32 				2022-04-14 Technik Gegg
  * Added SCL clock stretching timeout handler 	2022-06-05 Technik Gegg
+ * Added Hs-mode master code handshake 			2026-10-17 Technik Gegg
  */
 
 #include "SoftWire.h"
@@ -61,82 +62,210 @@
  * - always start with i2c_delay rather than end
  */
 
-void SoftWire::set_scl(bool state)
+void SoftWire::set_scl(bool state, bool condition)
 {
-    I2C_Delay(i2c_delay);
+    bool high = (state == HIGH) && !condition;
+    phase_delay(high);
 
     digitalWriteFast(scl_pin, state);
+    phase_edge(high);
     // Allow for clock stretching but no longer than STRETCH_TIMEOUT
     if (state == HIGH) {
 		uint32_t t = millis();
-        while (digitalReadFast(scl_pin) == LOW) {
-			if(millis()-t > STRETCH_TIMEOUT)
-				break;
-		}
+        if (!read_scl()) {
+            Trace::onStretch(this, false);
+            stats_untimed();
+            while (!read_scl()) {
+				if(millis()-t > STRETCH_TIMEOUT) {
+					scl_timeout = true;
+					Trace::onStretch(this, true);
+					break;
+				}
+			}
+            // the high phase starts when the target releases SCL
+            phase_edge(high);
+        }
     }
 }
 
 void SoftWire::set_sda(bool state)
 {
-    I2C_Delay(i2c_delay);
+    phase_delay(false);
     digitalWriteFast(sda_pin, state);
+    phase_edge(false);
+}
+
+void SoftWire::set_data(bool state)
+{
+    data_delay();
+    digitalWriteFast(sda_pin, state);
+    data_edge();
 }
 
 void SoftWire::i2c_start()
 {
     set_sda(LOW);
+    stamp_start();
+    Trace::onStart(this);
     set_scl(LOW);
 }
 
 void SoftWire::i2c_stop()
 {
-    set_sda(LOW);
-    set_scl(HIGH);
+    set_data(LOW);
+    set_scl(HIGH, true);
     set_sda(HIGH);
+    Trace::onStop(this);
+    // a Stop condition always ends Hs-mode
+    if (hs_active) {
+        hs_active = false;
+        i2c_delay = i2c_fs_delay;
+    }
+    if (as_held) {
+        // the asynchronous engine has accounted for its messages already
+        as_held = false;
+        bus_open = false;
+    } else if (bus_open) {
+        uint8_t stat = i2c_result();
+        stats_phases(I2C_PHASES_END);
+#if defined(SOFTWIRE_STATS)
+        // refine the cost model of the delay loop on clean F/S-mode
+        // transfers, run in one call and without stretching
+        if (stat == I2C_OK && xfer_timed && !hs_enabled)
+        {
+            uint32_t ns = (uint32_t)((uint64_t)(micros() - xfer_start) * 1000U / xfer_phases);
+            if (phase_ns_measured == 0 || phase_ns_delay != i2c_delay)
+                phase_ns_measured = ns;
+            else
+                phase_ns_measured = (phase_ns_measured * 7 + ns) / 8;
+            phase_ns_delay = i2c_delay;
+        }
+#endif
+        stats_record(stat, xfer_bytes, xfer_start);
+        cb_record(xfer_addr, stat);
+        // the transfer is closed only after its bookkeeping
+        bus_open = false;
+    }
+}
+
+uint8_t SoftWire::i2c_result()
+{
+    // an ACK bit read while a target held SCL low means nothing
+    if (scl_timeout)
+        return I2C_TIMEOUT;
+    return xfer_status;
 }
 
 void SoftWire::i2c_repeated_start()
 {
-    set_sda(HIGH);
-    set_scl(HIGH);
+    set_data(HIGH);
+    set_scl(HIGH, true);
     set_sda(LOW);
+    stats_phases(I2C_PHASES_END);
+}
+
+void SoftWire::i2c_hs_enter()
+{
+    i2c_fs_delay = i2c_delay;
+    i2c_start();
+    i2c_shift_out(hs_master_code);
+    i2c_get_ack();          // no device may ACK the master code
+    i2c_delay = i2c_hs_delay;
+    hs_active = true;
+    i2c_repeated_start();   // the Sr is already being sent at Hs speed
 }
 
 bool SoftWire::i2c_get_ack()
 {
     set_scl(LOW);
-    set_sda(HIGH);
+    set_data(HIGH);
     set_scl(HIGH);
 
-    bool ret = (digitalReadFast(sda_pin) == LOW);
+    bool ret = !read_sda();
+    Trace::onAck(this, ret, false);
     set_scl(LOW);
     return ret;
 }
 
 void SoftWire::i2c_send_ack()
 {
-    set_sda(LOW);
+    Trace::onAck(this, true, true);
+    set_data(LOW);
     set_scl(HIGH);
     set_scl(LOW);
 }
 
 void SoftWire::i2c_send_nack()
 {
-    set_sda(HIGH);
+    Trace::onAck(this, false, true);
+    set_data(HIGH);
     set_scl(HIGH);
     set_scl(LOW);
 }
 
+#if defined(SOFTWIRE_UNROLLED_SHIFT)
+inline void SoftWire::i2c_shift_out_bit(uint8_t bit)
+{
+    data_delay();
+    // BSRR sets the pin with the lower, resets it with the upper half word
+    sda_port->BSRR = sda_mask << ((~bit & 1) << 4);
+    data_edge();
+    set_scl(HIGH);
+    set_scl(LOW);
+}
+
+inline void SoftWire::i2c_shift_in_bit(uint8_t &data)
+{
+    set_scl(HIGH);
+    data = (data << 1) | read_sda();
+    set_scl(LOW);
+}
+
 uint8_t SoftWire::i2c_shift_in()
 {
     uint8_t data = 0;
-    set_sda(HIGH);
+    set_data(HIGH);
+
+    // the first bit is spelled out for its timestamp
+    set_scl(HIGH);
+    stamp_first_bit();
+    data = read_sda();
+    set_scl(LOW);
+    i2c_shift_in_bit(data);
+    i2c_shift_in_bit(data);
+    i2c_shift_in_bit(data);
+    i2c_shift_in_bit(data);
+    i2c_shift_in_bit(data);
+    i2c_shift_in_bit(data);
+    i2c_shift_in_bit(data);
+
+    return data;
+}
+
+void SoftWire::i2c_shift_out(uint8_t val)
+{
+    i2c_shift_out_bit(val >> 7);
+    i2c_shift_out_bit(val >> 6);
+    i2c_shift_out_bit(val >> 5);
+    i2c_shift_out_bit(val >> 4);
+    i2c_shift_out_bit(val >> 3);
+    i2c_shift_out_bit(val >> 2);
+    i2c_shift_out_bit(val >> 1);
+    i2c_shift_out_bit(val);
+}
+#else
+uint8_t SoftWire::i2c_shift_in()
+{
+    uint8_t data = 0;
+    set_data(HIGH);
 
     int i;
     for (i = 0; i < 8; i++)
     {
         set_scl(HIGH);
-        data |= digitalReadFast(sda_pin) ? (1 << (7 - i)) : 0;
+        if (i == 0)
+            stamp_first_bit();
+        data |= read_sda() ? (1 << (7 - i)) : 0;
         set_scl(LOW);
     }
 
@@ -148,68 +277,1024 @@ void SoftWire::i2c_shift_out(uint8_t val)
     int i;
     for (i = 0; i < 8; i++)
     {
-        set_sda(!!(val & (1 << (7 - i))));
+        set_data(!!(val & (1 << (7 - i))));
         set_scl(HIGH);
         set_scl(LOW);
     }
 }
+#endif
 
-// process needs to be updated for repeated start.
-uint8_t SoftWire::process(uint8_t stop)
+uint8_t SoftWire::read_filtered(PinName pin)
 {
-    itc_msg.xferred = 0;
+    // spread the samples across the high phase of SCL, but never closer
+    // than SOFTWIRE_SAMPLE_SPACING_NS (the delay may be 0 at fast clocks)
+    uint8_t high = 0;
+#if defined(SOFTWIRE_HAS_CYCCNT)
+    uint32_t spacing = high_length() / oversampling;
+    if (spacing < I2C_SAMPLE_SPACING_CYCLES)
+        spacing = I2C_SAMPLE_SPACING_CYCLES;
+    uint32_t t = DWT->CYCCNT;
+    for (uint8_t i = 0; i < oversampling; i++)
+    {
+        if (i)
+        {
+            t += spacing;
+            while ((int32_t)(DWT->CYCCNT - t) < 0) {}
+        }
+        high += (digitalReadFast(pin) != LOW);
+    }
+#else
+    uint16_t spacing = i2c_delay / oversampling;
+    if (spacing < I2C_SAMPLE_SPACING_LOOPS)
+        spacing = I2C_SAMPLE_SPACING_LOOPS;
+    for (uint8_t i = 0; i < oversampling; i++)
+    {
+        if (i)
+            I2C_Delay(spacing);
+        high += (digitalReadFast(pin) != LOW);
+    }
+#endif
+    return (high * 2 > oversampling);
+}
+
+void SoftWire::enable_cycle_counter()
+{
+#if defined(SOFTWIRE_HAS_CYCCNT)
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+#if defined(SOFTWIRE_HAS_CYCCNT)
+uint32_t SoftWire::rise_cycles(PinName pin)
+{
+    // give up after 100 us, no I2C bus rises that slowly
+    const uint32_t timeout = F_CPU / 10000;
+    digitalWriteFast(pin, LOW);
+    delayMicroseconds(5);
+    uint32_t t = SOFTWIRE_CYCLES();
+    digitalWriteFast(pin, HIGH);
+    uint32_t cycles;
+    while ((cycles = SOFTWIRE_CYCLES() - t) < timeout)
+    {
+        if (digitalReadFast(pin) != LOW)
+            return cycles;
+    }
+    return 0xFFFFFFFF;
+}
+
+i2c_bus_info SoftWire::measureBus(uint32_t pullupOhms, uint8_t riseFraction, bool apply)
+{
+    i2c_bus_info info;
+    info.ok = false;
+    info.sclRiseNs = info.sdaRiseNs = info.rcNs = info.capacitancePf = 0;
+    info.delay = i2c_delay;
+    info.phaseCycles = fs_timing.high;
+    // the pins are toggled without Start and Stop conditions, so nobody
+    // else may use them during the whole measurement
+    if (!claim())
+        return info;
+    if (bus_open)
+    {
+        release();
+        return info;
+    }
+    enable_cycle_counter();
+
+    // take the worst of a few runs; SDA is measured while SCL is low,
+    // so neither a Start nor a Stop condition is generated
+    uint32_t scl = 0, sda = 0;
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        uint32_t c = rise_cycles(scl_pin);
+        if (c > scl)
+            scl = c;
+        digitalWriteFast(scl_pin, LOW);
+        c = rise_cycles(sda_pin);
+        if (c > sda)
+            sda = c;
+        delayMicroseconds(5);
+        digitalWriteFast(scl_pin, HIGH);
+    }
+    info.ok = (scl != 0xFFFFFFFF && sda != 0xFFFFFFFF);
+    if (!info.ok)
+    {
+        release();
+        return info;
+    }
+    info.sclRiseNs = (uint64_t)scl * 1000000000ULL / F_CPU;
+    info.sdaRiseNs = (uint64_t)sda * 1000000000ULL / F_CPU;
+    uint32_t rise = (info.sclRiseNs > info.sdaRiseNs) ? info.sclRiseNs : info.sdaRiseNs;
+    // the inputs switch at about 0.7 VDD: t = RC * ln(1 / 0.3) = 1.2 RC
+    info.rcNs = rise * 10 / 12;
+    info.capacitancePf = (uint64_t)info.rcNs * 1000U / pullupOhms;
+
+    // SCL is high for about one bus phase
+    uint8_t delay = 0;
+    while (delay < 0xFF && (uint64_t)phase_ns(delay) * riseFraction < (uint64_t)rise * 100U)
+        delay++;
+    info.delay = delay;
+    info.phaseCycles = (uint64_t)((scl > sda) ? scl : sda) * 100U / (riseFraction ? riseFraction : 1);
+    if (info.phaseCycles < SOFTWIRE_PHASE_CYCLES)
+        info.phaseCycles = SOFTWIRE_PHASE_CYCLES;
+    if (apply)
+    {
+        if (fs_timing.low)
+        {
+            // SDA changes in the middle of the low phase, so a low phase of
+            // the same length leaves it as much time to rise as SCL has
+            if (fs_timing.high < info.phaseCycles)
+                fs_timing.high = info.phaseCycles;
+            if (fs_timing.high_min < info.phaseCycles)
+                fs_timing.high_min = info.phaseCycles;
+            if (fs_timing.low < info.phaseCycles)
+                fs_timing.low = info.phaseCycles;
+            if (fs_timing.low_min < info.phaseCycles)
+                fs_timing.low_min = info.phaseCycles;
+            phase_auto = false;
+        }
+        else if (hs_active)
+            i2c_fs_delay = delay;
+        else
+            i2c_delay = delay;
+    }
+    release();
+    return info;
+}
+#endif
+
+void SoftWire::setOversampling(uint8_t samples)
+{
+    oversampling = samples ? samples : 1;
+    if (oversampling > 1)
+        enable_cycle_counter();
+}
 
-    uint8_t sla_addr = (itc_msg.addr << 1);
-    if (itc_msg.flags == I2C_MSG_READ)
+uint8_t SoftWire::i2c_address(uint8_t sla_addr)
+{
+    if (!bus_open)
     {
-        sla_addr |= I2C_READ;
+        // first Start condition since the last Stop, stamped by i2c_start()
+        stamp_attempt();
+        if (!cb_allow(sla_addr >> 1))
+            return I2C_NACK_ADDR;
+        xfer_addr = sla_addr >> 1;
+        bus_open = true;
+        scl_timeout = false;
+        xfer_status = I2C_OK;
+        xfer_bytes = 0;
+        xfer_start = stats_start();
+#if defined(SOFTWIRE_STATS)
+        xfer_phases = 0;
+        xfer_timed = !elastic();
+#endif
+    }
+    // also when continuing after a repeated start, which may be long ago
+    phase_restart();
+    stats_phases(I2C_PHASES_START + I2C_PHASES_WRITE_BYTE);
+    if (hs_enabled && !hs_active)
+    {
+        i2c_hs_enter();
     }
     i2c_start();
     // shift out the address we're transmitting to
     i2c_shift_out(sla_addr);
-    if (!i2c_get_ack())
+    bool ack = i2c_get_ack();
+    Trace::onAddress(this, sla_addr, ack);
+    if (!ack)
     {
+        xfer_status = I2C_NACK_ADDR;
         i2c_stop(); // Roger Clark. 20141110 added to set clock high again, as it will be left in a low state otherwise
-        return I2C_NACK_ADDR;
+        return i2c_result();
     }
-    // Recieving
-    if (itc_msg.flags == I2C_MSG_READ)
+    return I2C_OK;
+}
+
+uint8_t SoftWire::i2c_write_bytes(const uint8_t *buf, uint16_t len, uint16_t &xferred)
+{
+    for (uint16_t i = 0; i < len; i++)
     {
-        while (itc_msg.xferred < itc_msg.length)
+        i2c_shift_out(buf[i]);
+        Trace::onByte(this, buf[i], false);
+        if (!i2c_get_ack())
         {
-            itc_msg.data[itc_msg.xferred++] = i2c_shift_in();
-            if (itc_msg.xferred < itc_msg.length)
+            xfer_status = I2C_NACK_DATA;
+            i2c_stop(); // Roger Clark. 20141110 added to set clock high again, as it will be left in a low state otherwise
+            return i2c_result();
+        }
+        xferred++;
+        stats_count(1);
+        stats_phases(I2C_PHASES_WRITE_BYTE);
+    }
+    return I2C_OK;
+}
+
+void SoftWire::i2c_read_bytes(uint8_t *buf, uint16_t len)
+{
+    // stamped on the rising SCL edge of the first bit (see i2c_shift_in())
+    stamp_read();
+    i2c_read_span(buf, len, true);
+}
+
+void SoftWire::i2c_read_span(uint8_t *buf, uint16_t len, bool last)
+{
+    for (uint16_t i = 0; i < len; i++)
+    {
+        buf[i] = i2c_shift_in();
+        Trace::onByte(this, buf[i], true);
+        stats_count(1);
+        stats_phases(I2C_PHASES_READ_BYTE);
+        if (i + 1 < len || !last)
+        {
+            i2c_send_ack();
+        }
+        else
+        {
+            i2c_send_nack();
+        }
+    }
+}
+
+void SoftWire::i2c_end(uint8_t stop)
+{
+    if (stop == true)
+        i2c_stop();
+    else
+        i2c_repeated_start();
+}
+
+// process needs to be updated for repeated start.
+uint8_t SoftWire::process(uint8_t stop)
+{
+    itc_msg.xferred = 0;
+    return exclusive<uint8_t>(I2C_BUSY, [&]() -> uint8_t {
+        uint8_t sla_addr = (itc_msg.addr << 1);
+        if (itc_msg.flags & I2C_MSG_READ)
+        {
+            sla_addr |= I2C_READ;
+        }
+        uint8_t stat = i2c_address(sla_addr);
+        if (stat != I2C_OK)
+            return stat;
+        // Recieving
+        if (itc_msg.flags & I2C_MSG_RING)
+        {
+            // the span may wrap around the end of rx_buf
+            uint16_t first = &rx_buf[I2C_TXRX_BUFFER_SIZE] - itc_msg.data;
+            if (first > itc_msg.length)
+                first = itc_msg.length;
+            stamp_read();
+            i2c_read_span(itc_msg.data, first, first == itc_msg.length);
+            i2c_read_span(rx_buf, itc_msg.length - first, true);
+            itc_msg.xferred = itc_msg.length;
+        }
+        else if (itc_msg.flags & I2C_MSG_READ)
+        {
+            i2c_read_bytes(itc_msg.data, itc_msg.length);
+            itc_msg.xferred = itc_msg.length;
+        }
+        // Sending
+        else
+        {
+            stat = i2c_write_bytes(itc_msg.data, itc_msg.length, itc_msg.xferred);
+            if (stat != I2C_OK)
+                return stat;
+        }
+        i2c_end(stop);
+
+        return i2c_result();
+    });
+}
+
+uint8_t SoftWire::readRegister(uint8_t addr, uint8_t reg, uint8_t *buf, uint16_t len, bool stop)
+{
+    return exclusive<uint8_t>(I2C_BUSY, [&]() -> uint8_t {
+        uint16_t xferred = 0;
+        uint8_t stat = i2c_address((addr << 1) | I2C_WRITE);
+        if (stat == I2C_OK)
+            stat = i2c_write_bytes(&reg, 1, xferred);
+        if (stat != I2C_OK)
+            return stat;
+        i2c_repeated_start();
+        stat = i2c_address((addr << 1) | I2C_READ);
+        if (stat != I2C_OK)
+            return stat;
+        i2c_read_bytes(buf, len);
+        i2c_end(stop);
+        return i2c_result();
+    });
+}
+
+uint8_t SoftWire::writeRegister(uint8_t addr, uint8_t reg, const uint8_t *buf, uint16_t len, bool stop)
+{
+    return exclusive<uint8_t>(I2C_BUSY, [&]() -> uint8_t {
+        uint16_t xferred = 0;
+        uint8_t stat = i2c_address((addr << 1) | I2C_WRITE);
+        if (stat == I2C_OK)
+            stat = i2c_write_bytes(&reg, 1, xferred);
+        if (stat == I2C_OK)
+            stat = i2c_write_bytes(buf, len, xferred);
+        if (stat != I2C_OK)
+            return stat;
+        i2c_end(stop);
+        return i2c_result();
+    });
+}
+
+uint8_t SoftWire::transfer(i2c_msg *msgs, uint8_t count)
+{
+    return exclusive<uint8_t>(I2C_BUSY, [&]() -> uint8_t {
+        for (uint8_t i = 0; i < count; i++)
+        {
+            i2c_msg &msg = msgs[i];
+            msg.xferred = 0;
+            bool reading = (msg.flags & I2C_MSG_READ) != 0;
+            uint8_t stat = i2c_address((msg.addr << 1) | (reading ? I2C_READ : I2C_WRITE));
+            if (stat != I2C_OK)
+                return stat;
+            if (reading)
             {
-                i2c_send_ack();
+                i2c_read_bytes(msg.data, msg.length);
+                msg.xferred = msg.length;
             }
             else
             {
-                i2c_send_nack();
+                stat = i2c_write_bytes(msg.data, msg.length, msg.xferred);
+                if (stat != I2C_OK)
+                    return stat;
             }
+            i2c_end(i == count - 1);
+        }
+        return i2c_result();
+    });
+}
+
+void SoftWire::stop()
+{
+    // also ends a Repeated Start held by the asynchronous engine
+    if (!claim(true))
+        return;
+    if (bus_open)
+    {
+        phase_restart();
+        i2c_stop();
+    }
+    release();
+}
+
+bool SoftWire::claim(bool take_held)
+{
+    uint16_t self = context();
+    // waiting is only possible in thread mode
+    if (self == 1)
+    {
+        SoftWire_Lock();
+        lock_depth++;
+    }
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    bool held = take_held && bus_owner == OWNER_ASYNC && as_held && as_state == AS_IDLE;
+    bool free = (bus_owner == OWNER_NONE || bus_owner == self || held);
+    if (free)
+    {
+        if (held)
+            claim_depth = 0;
+        bus_owner = self;
+        claim_depth++;
+    }
+    __set_PRIMASK(primask);
+    if (!free && self == 1)
+    {
+        lock_depth--;
+        SoftWire_Unlock();
+    }
+    return free;
+}
+
+void SoftWire::release()
+{
+    // a transfer left open stays owned, nobody else may continue it; the
+    // time until it's continued isn't bus time
+    if (--claim_depth)
+        return;
+    if (bus_open)
+    {
+        stats_untimed();
+        return;
+    }
+    bus_owner = OWNER_NONE;
+    while (lock_depth)
+    {
+        lock_depth--;
+        SoftWire_Unlock();
+    }
+}
+
+uint8_t SoftWire::updateBits(uint8_t addr, uint8_t reg, uint8_t mask, uint8_t value)
+{
+    return exclusive<uint8_t>(I2C_BUSY, [&]() -> uint8_t {
+        uint16_t xferred = 0;
+        uint8_t old_value;
+        uint8_t stat = i2c_address((addr << 1) | I2C_WRITE);
+        if (stat == I2C_OK)
+            stat = i2c_write_bytes(&reg, 1, xferred);
+        if (stat != I2C_OK)
+            return stat;
+        i2c_repeated_start();
+        stat = i2c_address((addr << 1) | I2C_READ);
+        if (stat != I2C_OK)
+            return stat;
+        i2c_read_bytes(&old_value, 1);
+
+        uint8_t new_value = (old_value & ~mask) | (value & mask);
+        if (new_value == old_value)
+        {
+            // nothing to change, just release the bus
+            i2c_stop();
+            return i2c_result();
+        }
+        // keep the bus with a repeated start, so no other master can interleave
+        i2c_repeated_start();
+        uint8_t buf[2] = { reg, new_value };
+        stat = i2c_address((addr << 1) | I2C_WRITE);
+        if (stat == I2C_OK)
+            stat = i2c_write_bytes(buf, sizeof(buf), xferred);
+        if (stat != I2C_OK)
+            return stat;
+        i2c_stop();
+        return i2c_result();
+    });
+}
+
+void SoftWire::setCircuitBreaker(uint8_t threshold, uint16_t backoffMs, uint16_t maxBackoffMs)
+{
+    cb_threshold = threshold;
+    cb_backoff = backoffMs;
+    cb_max_backoff = maxBackoffMs;
+    for (uint8_t i = 0; i < SOFTWIRE_BREAKER_SLOTS; i++)
+        cb_slots[i].addr = 0xFF;
+}
+
+bool SoftWire::isTripped(uint8_t addr)
+{
+    for (uint8_t i = 0; i < SOFTWIRE_BREAKER_SLOTS; i++)
+    {
+        if (cb_slots[i].addr == addr)
+            return cb_slots[i].state == CB_OPEN && (int32_t)(cb_slots[i].open_until - millis()) > 0;
+    }
+    return false;
+}
+
+bool SoftWire::cb_allow(uint8_t addr)
+{
+    if (cb_threshold == 0)
+        return true;
+    for (uint8_t i = 0; i < SOFTWIRE_BREAKER_SLOTS; i++)
+    {
+        if (cb_slots[i].addr != addr)
+            continue;
+        if (cb_slots[i].state != CB_OPEN)
+            return true;
+        if ((int32_t)(cb_slots[i].open_until - millis()) > 0)
+            return false;
+        // back-off expired, let a single probe through
+        cb_slots[i].state = CB_HALF_OPEN;
+        return true;
+    }
+    return true;
+}
+
+uint8_t SoftWire::cb_victim()
+{
+    // free slots first, then CLOSED ones (the one with the least failures),
+    // then the oldest HALF_OPEN one; an OPEN slot whose back-off has
+    // expired is as good as HALF_OPEN, it would be probed next
+    uint32_t now = millis();
+    uint8_t victim = SOFTWIRE_BREAKER_SLOTS;
+    uint8_t victim_rank = 3;
+    for (uint8_t i = 0; i < SOFTWIRE_BREAKER_SLOTS; i++)
+    {
+        uint8_t rank;
+        if (cb_slots[i].addr == 0xFF)
+            return i;
+        else if (cb_slots[i].state == CB_CLOSED)
+            rank = 0;
+        else if (cb_slots[i].state == CB_HALF_OPEN || (int32_t)(cb_slots[i].open_until - now) <= 0)
+            rank = 1;
+        else
+            continue;   // still cooling down
+        if (rank < victim_rank ||
+            (rank == victim_rank &&
+             (rank == 0 ? cb_slots[i].fails < cb_slots[victim].fails
+                        : (int32_t)(cb_slots[i].open_until - cb_slots[victim].open_until) < 0)))
+        {
+            victim = i;
+            victim_rank = rank;
+        }
+    }
+    return victim;
+}
+
+void SoftWire::cb_record(uint8_t addr, uint8_t stat)
+{
+    if (cb_threshold == 0)
+        return;
+    bool failed = (stat == I2C_NACK_ADDR || stat == I2C_TIMEOUT);
+    uint8_t slot = SOFTWIRE_BREAKER_SLOTS;
+    for (uint8_t i = 0; i < SOFTWIRE_BREAKER_SLOTS; i++)
+    {
+        if (cb_slots[i].addr == addr)
+        {
+            slot = i;
+            break;
+        }
+    }
+    if (!failed)
+    {
+        if (slot < SOFTWIRE_BREAKER_SLOTS)
+            cb_slots[slot].addr = 0xFF;     // healthy devices aren't tracked
+        return;
+    }
+    if (slot == SOFTWIRE_BREAKER_SLOTS)
+    {
+        slot = cb_victim();
+        if (slot == SOFTWIRE_BREAKER_SLOTS)
+            return;     // all slots are cooling down, addr stays untracked
+        cb_slots[slot].addr = addr;
+        cb_slots[slot].state = CB_CLOSED;
+        cb_slots[slot].fails = 0;
+        cb_slots[slot].backoff_exp = 0;
+    }
+    if (cb_slots[slot].fails < 0xFF)
+        cb_slots[slot].fails++;
+    if (cb_slots[slot].state == CB_HALF_OPEN)
+    {
+        // probe failed, back off longer
+        if (((uint32_t)cb_backoff << cb_slots[slot].backoff_exp) < cb_max_backoff)
+            cb_slots[slot].backoff_exp++;
+    }
+    else if (cb_slots[slot].state == CB_OPEN || cb_slots[slot].fails < cb_threshold)
+        return;
+    uint32_t backoff = (uint32_t)cb_backoff << cb_slots[slot].backoff_exp;
+    if (backoff > cb_max_backoff)
+        backoff = cb_max_backoff;
+    cb_slots[slot].state = CB_OPEN;
+    cb_slots[slot].open_until = millis() + backoff;
+}
+
+uint32_t SoftWire::sniff(I2CSnifferDecoder &decoder, uint32_t durationMs)
+{
+    // held for the whole duration, no transfer may take the pins meanwhile
+    if (!claim())
+        return 0;
+    if (bus_open)
+    {
+        release();
+        return 0;
+    }
+    pinMode(scl_pin, INPUT);
+    pinMode(sda_pin, INPUT);
+    decoder.reset();
+
+    GPIO_TypeDef *sda_gpio = get_GPIO_Port(STM_PORT(sda_pin));
+    GPIO_TypeDef *scl_gpio = get_GPIO_Port(STM_PORT(scl_pin));
+    uint32_t sda_bit = STM_GPIO_PIN(sda_pin);
+    uint32_t scl_bit = STM_GPIO_PIN(scl_pin);
+    uint32_t first = decoder.decoded();
+    uint8_t last = 0xFF;
+    uint32_t t = millis();
+    uint16_t n = 0;
+
+    while (true)
+    {
+        uint8_t lines;
+        if (sda_gpio == scl_gpio)
+        {
+            uint32_t idr = sda_gpio->IDR;
+            lines = ((idr & sda_bit) != 0) | (((idr & scl_bit) != 0) << 1);
+        }
+        else
+        {
+            lines = ((sda_gpio->IDR & sda_bit) != 0) | (((scl_gpio->IDR & scl_bit) != 0) << 1);
+        }
+        // only level changes matter to the decoder
+        if (lines != last)
+        {
+            decoder.feed(lines & 1, lines & 2);
+            last = lines;
         }
+        // checking the time on every sample would slow down the loop
+        if (++n == 0 && millis() - t > durationMs)
+            break;
     }
-    // Sending
+    release();
+    return decoder.decoded() - first;
+}
+
+bool SoftWire::attachDataReady(pin_t pin, i2c_read_plan &plan, uint32_t mode)
+{
+    for (uint8_t i = 0; i < SOFTWIRE_MAX_DATA_READY; i++)
+    {
+        if (dr_slots[i].plan == nullptr)
+        {
+            plan.pending = false;
+            plan.status = I2C_OK;
+            dr_slots[i].pin = pin;
+            dr_slots[i].plan = &plan;
+            pinMode(pin, INPUT);
+            i2c_read_plan *p = &plan;
+            attachInterrupt(pin, [this, p]() { dr_handler(p); }, mode);
+            return true;
+        }
+    }
+    return false;
+}
+
+void SoftWire::detachDataReady(pin_t pin)
+{
+    for (uint8_t i = 0; i < SOFTWIRE_MAX_DATA_READY; i++)
+    {
+        if (dr_slots[i].plan && dr_slots[i].pin == pin)
+        {
+            detachInterrupt(pin);
+            dr_slots[i].plan = nullptr;
+        }
+    }
+}
+
+void SoftWire::dr_handler(i2c_read_plan *plan)
+{
+    // never interfere with a running or open transfer; the read owns the
+    // pins from the claim to its callback
+    if (plan->deferred || !claim())
+    {
+        plan->pending = true;
+        return;
+    }
+    if (bus_open)
+        plan->pending = true;
     else
+        dr_run(plan);
+    release();
+}
+
+void SoftWire::dr_run(i2c_read_plan *plan)
+{
+    plan->pending = false;
+    uint8_t addr = plan->addr;
+    if (plan->smbalert)
     {
-        for (uint8_t i = 0; i < itc_msg.length; i++)
+        int16_t alert = smbusAlertResponse();
+        if (alert < 0)
         {
-            i2c_shift_out(itc_msg.data[i]);
-            if (!i2c_get_ack())
-            {
-                i2c_stop(); // Roger Clark. 20141110 added to set clock high again, as it will be left in a low state otherwise
-                return I2C_NACK_DATA;
-            }
-            itc_msg.xferred++;
+            plan->status = I2C_NACK_ADDR;
+            return;
         }
+        plan->alertAddr = alert;
+        addr = alert;
     }
-    if (stop == true)
+    plan->status = I2C_OK;
+    if (plan->length)
+        plan->status = readRegister(addr, plan->reg, plan->data, plan->length);
+#if defined(SOFTWIRE_TIMESTAMPS)
+    plan->stamps = stamps;
+#endif
+    if (plan->callback)
+        plan->callback(plan);
+}
+
+void SoftWire::serviceDataReady()
+{
+    // reads stay pending while the bus is owned elsewhere or left open
+    if (!claim())
+        return;
+    for (uint8_t i = 0; i < SOFTWIRE_MAX_DATA_READY && !bus_open; i++)
+    {
+        i2c_read_plan *plan = dr_slots[i].plan;
+        if (plan && plan->pending)
+            dr_run(plan);
+    }
+    release();
+}
+
+int16_t SoftWire::smbusAlertResponse()
+{
+    return exclusive<int16_t>(-1, [&]() -> int16_t {
+        uint8_t value;
+        if (i2c_address((I2C_SMBUS_ARA << 1) | I2C_READ) != I2C_OK)
+            return -1;
+        i2c_read_bytes(&value, 1);
         i2c_stop();
-    else
-        i2c_repeated_start();
+        if (i2c_result() != I2C_OK)
+            return -1;
+        return value >> 1;
+    });
+}
 
+uint8_t SoftWire::startAsync(i2c_msg *msg, bool stop)
+{
+    // neither overlap an asynchronous nor a blocking transfer, but continue
+    // a repeated start of the asynchronous engine; claimed in one step with
+    // interrupts masked like claim()
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    bool held = (bus_owner == OWNER_ASYNC && as_held && as_state == AS_IDLE);
+    bool free = held || bus_owner == OWNER_NONE;
+    if (free)
+    {
+        bus_owner = OWNER_ASYNC;
+        as_held = false;
+    }
+    __set_PRIMASK(primask);
+    if (!free)
+        return I2C_BUSY;
+    // the timestamps span the whole transfer, from its first Start
+    if (!held)
+        stamp_attempt();
+    if (msg->flags & I2C_MSG_READ)
+        stamp_read();
+    if (!cb_allow(msg->addr))
+    {
+        // a repeated start stays held until stop()
+        as_held = held;
+        if (!held)
+            bus_owner = OWNER_NONE;
+        return I2C_NACK_ADDR;
+    }
+    as_msg = msg;
+    as_msg->xferred = 0;
+    as_stop = stop;
+    as_read = (msg->flags & I2C_MSG_READ) != 0;
+    as_byte = -1;
+    as_bit = 0;
+    as_shift = (msg->addr << 1) | (as_read ? I2C_READ : I2C_WRITE);
+    as_status = I2C_BUSY;
+    as_start = stats_start();
+    scl_timeout = false;
+    as_state = AS_START_SDA;
     return I2C_OK;
 }
 
+void SoftWire::onAsyncDone(i2c_async_callback callback, void *arg)
+{
+    as_callback = callback;
+    as_callback_arg = arg;
+}
+
+void SoftWire::as_finish()
+{
+    if (scl_timeout)
+        as_status = I2C_TIMEOUT;
+    stats_record(as_status, as_msg->xferred, as_start);
+    cb_record(as_msg->addr, as_status);
+    // the bus is given back once the bookkeeping is done, so the callback
+    // can start the next transfer
+    as_state = AS_IDLE;
+    if (!as_held)
+        bus_owner = OWNER_NONE;
+    if (as_callback)
+        as_callback(as_status, as_callback_arg);
+}
+
+void SoftWire::as_next_byte()
+{
+    bool writing = !as_read || as_byte < 0;
+    if (writing)
+    {
+        if (!as_ack)
+        {
+            as_status = (as_byte < 0) ? I2C_NACK_ADDR : I2C_NACK_DATA;
+            as_state = AS_STOP_SDA;
+            return;
+        }
+        if (as_byte >= 0)
+            as_msg->xferred++;
+    }
+    as_byte++;
+    if (as_byte >= as_msg->length)
+    {
+        as_status = I2C_OK;
+        as_state = as_stop ? AS_STOP_SDA : AS_RSTART_SDA;
+        return;
+    }
+    if (!as_read)
+        as_shift = as_msg->data[as_byte];
+    as_state = AS_BIT_SDA;
+}
+
+uint8_t SoftWire::step()
+{
+    // reading data bytes (not the address)
+    bool reading = as_read && as_byte >= 0;
+
+    switch (as_state)
+    {
+        case AS_IDLE:
+            break;
+        case AS_START_SDA:
+            digitalWriteFast(sda_pin, LOW);
+            stamp_start();
+            Trace::onStart(this);
+            as_state = AS_START_SCL;
+            break;
+        case AS_START_SCL:
+            digitalWriteFast(scl_pin, LOW);
+            as_state = AS_BIT_SDA;
+            break;
+        case AS_BIT_SDA:
+            if (as_bit < 8)
+                digitalWriteFast(sda_pin, reading ? HIGH : (as_shift >> 7) & 1);
+            else if (reading)   // ACK all but the last byte
+            {
+                bool ack = as_msg->xferred < as_msg->length;
+                Trace::onAck(this, ack, true);
+                digitalWriteFast(sda_pin, ack ? LOW : HIGH);
+            }
+            else                // release SDA for the slave's ACK
+                digitalWriteFast(sda_pin, HIGH);
+            as_state = AS_BIT_SCL_HIGH;
+            break;
+        case AS_BIT_SCL_HIGH:
+            digitalWriteFast(scl_pin, HIGH);
+            if (reading && read_scl())
+                stamp_first_bit();
+            as_stretch_t = millis();
+            as_state = AS_BIT_SAMPLE;
+            break;
+        case AS_BIT_SAMPLE:
+            // Allow for clock stretching but no longer than STRETCH_TIMEOUT
+            if (!read_scl())
+            {
+                bool timeout = millis() - as_stretch_t > STRETCH_TIMEOUT;
+                Trace::onStretch(this, timeout);
+                if (!timeout)
+                    break;
+                scl_timeout = true;
+            }
+            // a stretched first bit is stamped once the target lets go
+            if (reading)
+                stamp_first_bit();
+            if (as_bit < 8)
+                as_shift = (as_shift << 1) | (reading ? read_sda() : 0);
+            else if (!reading)
+            {
+                as_ack = !read_sda();
+                if (as_byte < 0)
+                    Trace::onAddress(this, (as_msg->addr << 1) | (as_read ? I2C_READ : I2C_WRITE), as_ack);
+                else
+                    Trace::onAck(this, as_ack, false);
+            }
+            as_state = AS_BIT_SCL_LOW;
+            break;
+        case AS_BIT_SCL_LOW:
+            digitalWriteFast(scl_pin, LOW);
+            as_bit++;
+            if (as_bit == 8 && reading)
+            {
+                as_msg->data[as_msg->xferred++] = as_shift;
+                Trace::onByte(this, as_shift, true);
+            }
+            else if (as_bit == 8 && as_byte >= 0)
+                Trace::onByte(this, as_msg->data[as_byte], false);
+            if (as_bit < 9)
+            {
+                as_state = AS_BIT_SDA;
+                break;
+            }
+            as_bit = 0;
+            as_next_byte();
+            break;
+        case AS_STOP_SDA:
+            digitalWriteFast(sda_pin, LOW);
+            as_state = AS_STOP_SCL;
+            break;
+        case AS_STOP_SCL:
+            digitalWriteFast(scl_pin, HIGH);
+            as_stretch_t = millis();
+            as_state = AS_STOP_SDA_HIGH;
+            break;
+        case AS_STOP_SDA_HIGH:
+            if (!read_scl())
+            {
+                if (millis() - as_stretch_t <= STRETCH_TIMEOUT)
+                    break;
+                scl_timeout = true;
+            }
+            digitalWriteFast(sda_pin, HIGH);
+            Trace::onStop(this);
+            as_held = false;
+            bus_open = false;
+            as_finish();
+            break;
+        case AS_RSTART_SDA:
+            digitalWriteFast(sda_pin, HIGH);
+            as_state = AS_RSTART_SCL;
+            break;
+        case AS_RSTART_SCL:
+            digitalWriteFast(scl_pin, HIGH);
+            as_stretch_t = millis();
+            as_state = AS_RSTART_SDA_LOW;
+            break;
+        case AS_RSTART_SDA_LOW:
+            if (!read_scl())
+            {
+                if (millis() - as_stretch_t <= STRETCH_TIMEOUT)
+                    break;
+                scl_timeout = true;
+            }
+            digitalWriteFast(sda_pin, LOW);
+            // the bus stays held until the next Stop of either engine
+            as_held = true;
+            bus_open = true;
+            as_finish();
+            break;
+    }
+    return as_status;
+}
+
+uint8_t SoftWire::runScript(const uint8_t *script, uint16_t *failedAt)
+{
+    if (!claim())
+        return I2C_BUSY;
+    const uint8_t *pc = script;
+    int16_t open_addr = -1;     // device of the write transfer still open
+    uint16_t xferred = 0;
+    uint8_t stat = I2C_OK;
+
+    while (stat == I2C_OK && *pc != I2C_OP_END)
+    {
+        const uint8_t *op = pc;
+        if (*op != I2C_OP_WRITE && open_addr >= 0)
+        {
+            i2c_stop();
+            open_addr = -1;
+        }
+        switch (*op)
+        {
+            case I2C_OP_WRITE:
+                if (open_addr != op[1])
+                {
+                    if (open_addr >= 0)
+                        i2c_stop();
+                    open_addr = -1;
+                    stat = i2c_address((op[1] << 1) | I2C_WRITE);
+                    if (stat != I2C_OK)
+                        break;
+                    open_addr = op[1];
+                }
+                stat = i2c_write_bytes(&op[3], op[2], xferred);
+                if (stat != I2C_OK)
+                    open_addr = -1;     // bus has been stopped already
+                pc += 3 + op[2];
+                break;
+            case I2C_OP_STOP:
+                pc += 1;
+                break;
+            case I2C_OP_CHECK: {
+                uint8_t value;
+                stat = readRegister(op[1], op[2], &value, 1);
+                if (stat == I2C_OK && (value & op[3]) != op[4])
+                    stat = I2C_ERROR;
+                pc += 5;
+                break;
+            }
+            case I2C_OP_DELAY:
+                delay(op[1] | (op[2] << 8));
+                pc += 3;
+                break;
+            case I2C_OP_POLL: {
+                uint32_t t = millis();
+                uint16_t timeout = op[2] | (op[3] << 8);
+                while ((stat = i2c_address((op[1] << 1) | I2C_WRITE)) != I2C_OK)
+                {
+                    if (millis() - t > timeout)
+                    {
+                        stat = I2C_TIMEOUT;
+                        break;
+                    }
+                }
+                if (stat == I2C_OK)
+                    i2c_stop();
+                pc += 4;
+                break;
+            }
+            case I2C_OP_SPEED:
+                setClock((uint32_t)(op[1] | (op[2] << 8)) * 1000U);
+                pc += 3;
+                break;
+            default:
+                stat = I2C_ERROR;
+                break;
+        }
+        if (stat != I2C_OK && failedAt)
+            *failedAt = op - script;
+    }
+    if (open_addr >= 0)
+        i2c_stop();
+    release();
+    return stat;
+}
+
 // For compatibility with legacy code
 uint8_t SoftWire::process()
 {
@@ -218,10 +1303,33 @@ uint8_t SoftWire::process()
 
 // TODO: Add in Error Handling if pins is out of range for other Maples
 // TODO: Make delays more capable
-SoftWire::SoftWire(pin_t sda, pin_t scl, uint8_t delay) : i2c_delay(delay)
+SoftWire::SoftWire(pin_t sda, pin_t scl, uint8_t delay) : i2c_delay(delay), i2c_fs_delay(delay),
+    i2c_hs_delay(SOFT_HS), hs_master_code(I2C_HS_MASTER_CODE), hs_enabled(false), hs_active(false),
+    as_state(AS_IDLE), as_status(I2C_OK), as_held(false), as_msg(nullptr), as_callback(nullptr), as_callback_arg(nullptr),
+    bus_owner(OWNER_NONE), claim_depth(0), lock_depth(0), bus_open(false), scl_timeout(false), xfer_status(I2C_OK), oversampling(1)
 {
+    rx_ring = true;     // process() splits reads wrapping around rx_buf
+    setCircuitBreaker(0);
+    resetStats();
+    for (uint8_t i = 0; i < SOFTWIRE_MAX_DATA_READY; i++)
+        dr_slots[i].plan = nullptr;
+#if defined(SOFTWIRE_TIMESTAMPS)
+    stamps.start = stamps.firstBit = 0;
+    stamp_start_due = stamp_bit_due = false;
+#endif
     scl_pin = digitalPinToPinName(scl);
     sda_pin = digitalPinToPinName(sda);
+#if defined(SOFTWIRE_UNROLLED_SHIFT)
+    sda_port = get_GPIO_Port(STM_PORT(sda_pin));
+    sda_mask = STM_GPIO_PIN(sda_pin);   // not STM_LL_GPIO_PIN(), which is encoded on the F1
+#endif
+#if defined(SOFTWIRE_HAS_CYCCNT)
+    bus_hz = (delay == SOFT_FAST) ? 400000 : 100000;
+    fs_timing = phase_timing();
+    hs_timing = phase_timing();
+    phase_auto = true;
+    deadline = 0;
+#endif
 }
 
 void SoftWire::begin(uint8_t self_addr)
@@ -229,12 +1337,28 @@ void SoftWire::begin(uint8_t self_addr)
     UNUSED(self_addr);
     tx_buf_idx = 0;
     tx_buf_overflow = false;
-    rx_buf_idx = 0;
-    rx_buf_len = 0;
+    rx_head = 0;
+    rx_tail = 0;
+#if defined(SOFTWIRE_TIMESTAMPS)
+    enable_cycle_counter();
+#endif
+    // the pins are left alone while a transfer owns them
+    if (!claim())
+        return;
     pinMode(scl_pin, OUTPUT_OPEN_DRAIN);
     pinMode(sda_pin, OUTPUT_OPEN_DRAIN);
-    set_scl(HIGH);
-    set_sda(HIGH);
+    phase_restart();
+    if (bus_open)
+    {
+        // a transfer left open is ended, so its owner lets go of the bus
+        i2c_stop();
+    }
+    else
+    {
+        set_scl(HIGH, true);
+        set_sda(HIGH);
+    }
+    release();
 }
 
 void SoftWire::end()
@@ -249,19 +1373,228 @@ void SoftWire::end()
     }
 }
 
+uint8_t SoftWire::endTransmission(bool sendStop)
+{
+    return transmit([this, sendStop]() { return process(sendStop); });
+}
+
+uint8_t SoftWire::requestFrom(uint8_t address, uint8_t quantity, bool sendStop)
+{
+    return request(address, quantity, [this, sendStop]() { return process(sendStop); });
+}
+
 void SoftWire::setClock(uint32_t frequencyHz)
 {
+    uint8_t delay;
     switch (frequencyHz)
     {
+		case 3400000:
+			// the master code has to be sent in Fast-mode
+			delay = SOFT_FAST;
+			break;
 		case 400000:
-			i2c_delay = SOFT_FAST;
+			delay = SOFT_FAST;
 			break;
 		case 100000:
 		default:
-			i2c_delay = SOFT_STANDARD;
+			delay = SOFT_STANDARD;
 			break;
     }
+    if (hs_active)
+        i2c_fs_delay = delay;   // applied after the next Stop
+    else
+        i2c_delay = delay;
+    hs_enabled = (frequencyHz == 3400000);
+#if defined(SOFTWIRE_HAS_CYCCNT)
+    bus_hz = hs_enabled ? 400000 : (frequencyHz ? frequencyHz : 100000);
+    if (fs_timing.low && phase_auto)
+        phase_from_clock();
+#endif
+}
+
+#if defined(SOFTWIRE_HAS_CYCCNT)
+void SoftWire::phase_from_clock()
+{
+    // SDA changes don't take a phase, so a bit is a low and a high phase
+    // (see data_delay()); anything above Fast-mode Plus runs at its timing
+    if (bus_hz <= 100000)
+        phase_split(fs_timing, bus_hz, I2C_SM_LOW_NS, I2C_SM_HIGH_NS);
+    else if (bus_hz <= 400000)
+        phase_split(fs_timing, bus_hz, I2C_FM_LOW_NS, I2C_FM_HIGH_NS);
+    else
+        phase_split(fs_timing, bus_hz, I2C_FMP_LOW_NS, I2C_FMP_HIGH_NS);
+    phase_split(hs_timing, 3400000U, I2C_HS_LOW_NS, I2C_HS_HIGH_NS);
+}
+
+void SoftWire::phase_split(phase_timing &timing, uint32_t hz, uint32_t low_ns, uint32_t high_ns)
+{
+    uint32_t period = F_CPU / hz;
+    timing.low_min = (uint32_t)(((uint64_t)low_ns * F_CPU + 999999999ULL) / 1000000000ULL);
+    timing.high_min = (uint32_t)(((uint64_t)high_ns * F_CPU + 999999999ULL) / 1000000000ULL);
+    uint32_t spare = 0;
+    if (period > timing.low_min + timing.high_min)
+        spare = period - timing.low_min - timing.high_min;
+    timing.low = timing.low_min + spare / 2;
+    timing.high = timing.high_min + spare - spare / 2;
+}
+
+void SoftWire::setElasticTiming(bool enable, uint32_t phaseCycles)
+{
+    if (!enable)
+    {
+        fs_timing.low = 0;
+        return;
+    }
+    enable_cycle_counter();
+    phase_auto = (phaseCycles == 0);
+    if (phase_auto)
+    {
+        phase_from_clock();
+    }
+    else
+    {
+        fs_timing.low = fs_timing.high = fs_timing.low_min = fs_timing.high_min = phaseCycles;
+        hs_timing = fs_timing;
+    }
+}
+#endif
+
+void SoftWire::setHsMode(bool enable, uint8_t masterCode, uint8_t hsDelay)
+{
+    hs_enabled = enable;
+    hs_master_code = masterCode;
+    i2c_hs_delay = hsDelay;
+}
+
+uint32_t SoftWire::phase_ns(uint8_t delay) const
+{
+#if defined(SOFTWIRE_STATS)
+    if (phase_ns_measured && phase_ns_delay == delay)
+        return phase_ns_measured;
+#endif
+    return (uint32_t)((uint64_t)(SOFTWIRE_PHASE_CYCLES + delay * SOFTWIRE_LOOP_CYCLES) * 1000000000ULL / F_CPU);
+}
+
+uint32_t SoftWire::msg_phases(const i2c_msg &msg, bool elastic)
+{
+    if (elastic)
+    {
+        uint32_t per_byte = (msg.flags & I2C_MSG_READ) ? I2C_ELASTIC_PHASES_READ_BYTE : I2C_ELASTIC_PHASES_WRITE_BYTE;
+        return I2C_PHASES_START + I2C_ELASTIC_PHASES_WRITE_BYTE + msg.length * per_byte;
+    }
+    uint32_t per_byte = (msg.flags & I2C_MSG_READ) ? I2C_PHASES_READ_BYTE : I2C_PHASES_WRITE_BYTE;
+    return I2C_PHASES_START + I2C_PHASES_WRITE_BYTE + msg.length * per_byte;
+}
+
+uint32_t SoftWire::estimateDuration(const i2c_msg *msgs, uint8_t count) const
+{
+#if defined(SOFTWIRE_HAS_CYCCNT)
+    if (fs_timing.low)
+    {
+        const phase_timing &t = hs_enabled ? hs_timing : fs_timing;
+        uint64_t cycles = 0;
+        for (uint8_t i = 0; i < count; i++)
+        {
+            // address and data bytes each have their high phases
+            uint32_t high = (1U + msgs[i].length) * I2C_ELASTIC_PHASES_HIGH_BYTE;
+            uint32_t low = msg_phases(msgs[i], true) + I2C_ELASTIC_PHASES_END - high;
+            cycles += (uint64_t)low * t.low + (uint64_t)high * t.high;
+        }
+        // Hs-mode: the master code goes out at F/S speed
+        if (hs_enabled && !hs_active)
+            cycles += (uint64_t)(I2C_PHASES_START + I2C_ELASTIC_PHASES_WRITE_BYTE + I2C_ELASTIC_PHASES_END - I2C_ELASTIC_PHASES_HIGH_BYTE) * fs_timing.low +
+                      (uint64_t)I2C_ELASTIC_PHASES_HIGH_BYTE * fs_timing.high;
+        return cycles * 1000000U / F_CPU;
+    }
+#endif
+    uint32_t phases = 0;
+    for (uint8_t i = 0; i < count; i++)
+        phases += msg_phases(msgs[i]) + I2C_PHASES_END;
+
+    if (!hs_enabled)
+        return (uint64_t)phases * phase_ns(i2c_delay) / 1000U;
+
+    // Hs-mode: the master code goes out at F/S speed, the rest at Hs speed
+    uint8_t fs_delay = hs_active ? i2c_fs_delay : i2c_delay;
+    uint32_t ns = (uint64_t)phases * phase_ns(i2c_hs_delay);
+    if (!hs_active)
+        ns += (I2C_PHASES_START + I2C_PHASES_WRITE_BYTE + I2C_PHASES_END) * phase_ns(fs_delay);
+    return ns / 1000U;
+}
+
+uint32_t SoftWire::estimateDuration(const i2c_msg &msg) const
+{
+    return estimateDuration(&msg, 1);
+}
+
+#if defined(SOFTWIRE_STATS)
+void SoftWire::stats_record(uint8_t stat, uint16_t bytes, uint32_t start_us)
+{
+    uint32_t now = micros();
+    stats.transfers++;
+    stats.bytes += bytes;
+    stats.busy_us += now - start_us;
+    if (stat != I2C_OK)
+    {
+        stats.errors++;
+        if (stat == I2C_NACK_ADDR)
+            stats.nacks_addr++;
+        else if (stat == I2C_NACK_DATA)
+            stats.nacks_data++;
+        else if (stat == I2C_TIMEOUT)
+            stats.timeouts++;
+        if (!stats_failing)
+        {
+            stats_failing = true;
+            stats_fail_since = start_us;
+        }
+    }
+    else if (stats_failing)
+    {
+        // first successful transfer after an error
+        uint32_t recovery = now - stats_fail_since;
+        stats_failing = false;
+        stats.recoveries++;
+        stats.recovery_us += recovery;
+        if (recovery > stats.max_recovery_us)
+            stats.max_recovery_us = recovery;
+    }
+}
+
+void SoftWire::resetStats()
+{
+    memset(&stats, 0, sizeof(stats));
+    stats_failing = false;
+    phase_ns_measured = 0;
+}
+
+static void print_stat(Print &out, const char *name, uint32_t value, bool last = false)
+{
+    out.print("\"");
+    out.print(name);
+    out.print("\":");
+    out.print((unsigned long)value);
+    if (!last)
+        out.print(",");
+}
+
+void SoftWire::printStats(Print &out)
+{
+    out.print("{");
+    print_stat(out, "transfers", stats.transfers);
+    print_stat(out, "bytes", stats.bytes);
+    print_stat(out, "busy_us", stats.busy_us);
+    print_stat(out, "bytes_per_s", stats.busy_us ? (uint32_t)((uint64_t)stats.bytes * 1000000U / stats.busy_us) : 0);
+    print_stat(out, "errors", stats.errors);
+    print_stat(out, "nacks_addr", stats.nacks_addr);
+    print_stat(out, "nacks_data", stats.nacks_data);
+    print_stat(out, "timeouts", stats.timeouts);
+    print_stat(out, "recoveries", stats.recoveries);
+    print_stat(out, "avg_recovery_us", stats.recoveries ? stats.recovery_us / stats.recoveries : 0);
+    print_stat(out, "max_recovery_us", stats.max_recovery_us, true);
+    out.println("}");
 }
+#endif
 
 SoftWire::~SoftWire()
 {
@@ -276,6 +1609,12 @@ WEAK void I2C_Delay(uint16_t loops) {
    }
 }
 
+WEAK void SoftWire_Lock() {
+}
+
+WEAK void SoftWire_Unlock() {
+}
+
 // Declare the instance that the users of the library can use
 // SoftWire Wire(SCL, SDA, SOFT_STANDARD);
 // SoftWire Wire(PB6, PB7, SOFT_FAST);
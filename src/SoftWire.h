@@ -54,6 +54,8 @@
 
 #include <Arduino.h>
 #include "WireBase.h"
+#include "SoftWireTrace.h"
+#include "I2CSniffer.h"
 
 #if defined(STM32_CORE_VERSION)
 typedef uint32_t pin_t;
@@ -70,6 +72,17 @@ typedef uint8_t pin_t;
 #define SOFT_STANDARD   3
 #define SOFT_FAST       1
 #define SOFT_SLOW       5
+// Hs-mode (3.4 MHz) only makes sense on fast MCUs (i.e. STM32H7), where
+// the bit-banged bus runs well above 1 MHz without any additional delay.
+#define SOFT_HS         0
+
+// Define SOFTWIRE_UNROLLED_SHIFT in your build flags to use the unrolled,
+// branch-free byte shifter. It accesses the GPIO registers of the SDA pin
+// directly and gives a more deterministic bit timing at higher speeds.
+
+// Hs-mode master codes are 0000 1xxx; the lower three bits identify the
+// master on multi-master buses. The master code must never be acknowledged.
+#define I2C_HS_MASTER_CODE  0x08
 
 // the following values defines a Clock-Stretching timeout value
 // in ms. It's being used to interrupt the wait on a stretched SCL clock
@@ -77,6 +90,189 @@ typedef uint8_t pin_t;
 // could make the whole program hang infinite.
 #define STRETCH_TIMEOUT	2000
 
+/**
+ * @brief Byte order of multi-byte registers, used by the typed register
+ *        accessors of SoftWire (readReg/readRegs/writeReg/writeRegs).
+ */
+enum I2CByteOrder {
+    I2C_BIG_ENDIAN,
+    I2C_LITTLE_ENDIAN
+};
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define I2C_NATIVE_ORDER    I2C_BIG_ENDIAN
+#else
+#define I2C_NATIVE_ORDER    I2C_LITTLE_ENDIAN
+#endif
+
+/*
+ * Transaction scripts for device initialisation. Scripts are plain const byte
+ * arrays (hence stored in flash) built with the macros below, i.e.:
+ *
+ *   static const uint8_t oledInit[] = {
+ *       I2C_SCRIPT_POLL(0x3C, 100),
+ *       I2C_SCRIPT_WRITE(0x3C, 3), 0x00, 0xAE, 0xD5,
+ *       I2C_SCRIPT_WRITE(0x3C, 2), 0x80, 0xA8,
+ *       I2C_SCRIPT_DELAY(10),
+ *       I2C_SCRIPT_CHECK(0x3C, 0x00, 0x40, 0x40),
+ *       I2C_SCRIPT_END
+ *   };
+ *   myI2C.runScript(oledInit);
+ *
+ * Consecutive writes to the same device are merged into one transfer (the
+ * two writes above are sent as 5 data bytes). Use I2C_SCRIPT_STOP in between
+ * if the device needs separate transfers.
+ */
+#define I2C_OP_END          0x00    // end of script
+#define I2C_OP_WRITE        0x01    // addr, len, data[len]
+#define I2C_OP_STOP         0x02    // ends the current write transfer
+#define I2C_OP_CHECK        0x03    // addr, reg, mask, value: fails if (reg & mask) != value
+#define I2C_OP_DELAY        0x04    // ms (16 bit, little endian)
+#define I2C_OP_POLL         0x05    // addr, timeout ms (16 bit): waits until the device ACKs
+#define I2C_OP_SPEED        0x06    // bus clock in kHz (16 bit), see setClock()
+
+#define I2C_SCRIPT_U16(v)                   (uint8_t)((v) & 0xFF), (uint8_t)(((v) >> 8) & 0xFF)
+#define I2C_SCRIPT_END                      I2C_OP_END
+#define I2C_SCRIPT_WRITE(addr, len)         I2C_OP_WRITE, (addr), (len)
+#define I2C_SCRIPT_STOP                     I2C_OP_STOP
+#define I2C_SCRIPT_CHECK(addr, reg, mask, value) I2C_OP_CHECK, (addr), (reg), (mask), (value)
+#define I2C_SCRIPT_DELAY(ms)                I2C_OP_DELAY, I2C_SCRIPT_U16(ms)
+#define I2C_SCRIPT_POLL(addr, ms)           I2C_OP_POLL, (addr), I2C_SCRIPT_U16(ms)
+#define I2C_SCRIPT_SPEED(khz)               I2C_OP_SPEED, I2C_SCRIPT_U16(khz)
+
+// Cost model of the bus timing, used by SoftWire::estimateDuration().
+// A bus phase (one call to set_sda/set_scl) takes about
+// SOFTWIRE_PHASE_CYCLES + i2c_delay * SOFTWIRE_LOOP_CYCLES CPU cycles.
+// If SOFTWIRE_STATS is defined, the estimate is refined by the time
+// measured on previous transfers. With elastic timing, the phases last
+// exactly as configured and SDA changes while SCL is low don't count.
+#ifndef SOFTWIRE_PHASE_CYCLES
+#define SOFTWIRE_PHASE_CYCLES   24
+#endif
+#ifndef SOFTWIRE_LOOP_CYCLES
+#define SOFTWIRE_LOOP_CYCLES    4
+#endif
+// Minimum time between the reads of an oversampled SDA/SCL sample (see
+// SoftWire::setOversampling()), so a single spike can't hit two of them.
+// Fast-mode inputs have to suppress spikes of up to 50 ns.
+#ifndef SOFTWIRE_SAMPLE_SPACING_NS
+#define SOFTWIRE_SAMPLE_SPACING_NS  50
+#endif
+#define I2C_SAMPLE_SPACING_CYCLES   ((SOFTWIRE_SAMPLE_SPACING_NS * (F_CPU / 1000000U) + 999U) / 1000U)
+#define I2C_SAMPLE_SPACING_LOOPS    ((I2C_SAMPLE_SPACING_CYCLES + SOFTWIRE_LOOP_CYCLES - 1) / SOFTWIRE_LOOP_CYCLES)
+
+// bus phases per condition / byte (including the ACK bit)
+#define I2C_PHASES_START        2
+#define I2C_PHASES_END          3
+#define I2C_PHASES_WRITE_BYTE   28
+#define I2C_PHASES_READ_BYTE    20
+// the same with elastic timing (see SoftWire::data_delay()), 9 of the
+// phases of each byte are SCL high phases, all others last the low time
+#define I2C_ELASTIC_PHASES_END          2
+#define I2C_ELASTIC_PHASES_WRITE_BYTE   19
+#define I2C_ELASTIC_PHASES_READ_BYTE    18
+#define I2C_ELASTIC_PHASES_HIGH_BYTE    9
+
+// Minimum SCL low and high times in ns of the speed modes (I2C-bus
+// specification UM10204), kept by elastic timing. The low time also covers
+// the setup and hold times of the conditions and the bus free time.
+#define I2C_SM_LOW_NS           4700
+#define I2C_SM_HIGH_NS          4000
+#define I2C_FM_LOW_NS           1300
+#define I2C_FM_HIGH_NS          600
+#define I2C_FMP_LOW_NS          500
+#define I2C_FMP_HIGH_NS         260
+#define I2C_HS_LOW_NS           160
+#define I2C_HS_HIGH_NS          60
+
+/**
+ * @brief Transfer statistics, collected if SOFTWIRE_STATS is defined in
+ *        the build flags. A transfer spans from a Start to the next Stop.
+ */
+typedef struct i2c_stats {
+    uint32_t    transfers;          /**< Completed transfers */
+    uint32_t    bytes;              /**< Data bytes transferred */
+    uint32_t    busy_us;            /**< Time spent in transfers */
+    uint32_t    errors;             /**< Transfers that failed */
+    uint32_t    nacks_addr;         /**< Failed due to address NACK */
+    uint32_t    nacks_data;         /**< Failed due to data NACK */
+    uint32_t    timeouts;           /**< Failed due to clock stretching timeout */
+    uint32_t    recoveries;         /**< Successful transfers following an error */
+    uint32_t    recovery_us;        /**< Sum of the times from first error to recovery */
+    uint32_t    max_recovery_us;    /**< Worst case recovery time */
+} i2c_stats;
+
+// Cycle counter used for timestamps. Cortex-M0/M0+ don't have a DWT
+// cycle counter, there the timestamps fall back to micros().
+#if defined(DWT) && defined(__CORTEX_M) && (__CORTEX_M >= 3)
+#define SOFTWIRE_HAS_CYCCNT
+#define SOFTWIRE_CYCLES()       (DWT->CYCCNT)
+#else
+#define SOFTWIRE_CYCLES()       micros()
+#endif
+
+/**
+ * @brief Timestamps of the last transfer, captured if SOFTWIRE_TIMESTAMPS
+ *        is defined in the build flags. Values are in CPU cycles (see
+ *        SOFTWIRE_CYCLES).
+ */
+typedef struct i2c_timestamps {
+    uint32_t    start;              /**< First Start condition of the transfer (before the Hs master code) */
+    uint32_t    firstBit;           /**< First data bit of the last read (0 if none) */
+} i2c_timestamps;
+
+// Number of devices the circuit breaker keeps track of at the same time
+#ifndef SOFTWIRE_BREAKER_SLOTS
+#define SOFTWIRE_BREAKER_SLOTS  8
+#endif
+
+/**
+ * @brief Result of SoftWire::measureBus()
+ */
+typedef struct i2c_bus_info {
+    bool        ok;                 /**< false if the bus was busy or a line didn't go high (stuck or missing pull-up) */
+    uint32_t    sclRiseNs;          /**< SCL: time from release until it reads high */
+    uint32_t    sdaRiseNs;          /**< SDA: time from release until it reads high */
+    uint32_t    rcNs;               /**< Estimated RC time constant of the slower line */
+    uint32_t    capacitancePf;      /**< Estimated bus capacitance for the given pull-up */
+    uint8_t     delay;              /**< Fastest delay keeping the rise time within limits */
+    uint32_t    phaseCycles;        /**< Shortest elastic SCL high phase for this rise time in CPU cycles */
+} i2c_bus_info;
+
+// SMBus Alert Response Address
+#define I2C_SMBUS_ARA           0x0C
+
+#ifndef SOFTWIRE_MAX_DATA_READY
+#define SOFTWIRE_MAX_DATA_READY 4
+#endif
+
+/**
+ * @brief Read launched by a data ready (or SMBALERT) interrupt,
+ *        see SoftWire::attachDataReady().
+ */
+typedef struct i2c_read_plan {
+    uint8_t     addr;               /**< Device address */
+    uint8_t     reg;                /**< First register to read */
+    uint8_t     *data;              /**< Destination */
+    uint16_t    length;             /**< Number of bytes to read */
+    bool        deferred;           /**< Run from serviceDataReady() instead of the interrupt */
+    bool        smbalert;           /**< Line is SMBALERT: query the ARA first, see alertAddr */
+    void        (*callback)(struct i2c_read_plan *plan);   /**< Called after each read (optional) */
+    void        *arg;               /**< User data for the callback */
+    volatile bool    pending;       /**< Edge seen, read not done yet */
+    volatile uint8_t status;        /**< Bus status of the last read */
+    volatile uint8_t alertAddr;     /**< Device that answered the ARA (smbalert only) */
+#if defined(SOFTWIRE_TIMESTAMPS)
+    i2c_timestamps   stamps;        /**< Timestamps of the last read */
+#endif
+} i2c_read_plan;
+
+/**
+ * @brief Completion callback of the asynchronous engine. Called from
+ *        SoftWire::step(), hence possibly from an interrupt.
+ */
+typedef void (*i2c_async_callback)(uint8_t status, void *arg);
+
 /**
  * @brief Weakened function for inserting delays after SDA/SCL have been set/reset.
  *        Since this function is declared as WEAK, one can easily overwrite it
@@ -87,24 +283,455 @@ typedef uint8_t pin_t;
  */
 extern WEAK void I2C_Delay(uint16_t loops);
 
-class SoftWire : public WireBase
+/**
+ * @brief Weakened functions taking and giving back a lock around the
+ *        blocking transfers, called in thread mode only. They do nothing by
+ *        default; overwrite them if several tasks of an RTOS share a bus.
+ *        A transfer left open with a Repeated Start (stop = false) keeps
+ *        the lock until the call ending it, so the lock has to be
+ *        recursive (i.e. a recursive mutex). Interrupt handlers never wait
+ *        for it, they get I2C_BUSY while another context owns the bus.
+ */
+extern WEAK void SoftWire_Lock();
+extern WEAK void SoftWire_Unlock();
+
+class SoftWire;
+
+// Define SOFTWIRE_STATIC_DISPATCH in your build flags to derive SoftWire
+// from the CRTP base instead of the polymorphic WireBase. This removes the
+// virtual process() call from endTransmission()/requestFrom(), but SoftWire
+// can't be passed as a WireBase anymore. process() and the bit shifting stay
+// out of line in SoftWire.cpp.
+#if defined(SOFTWIRE_STATIC_DISPATCH)
+typedef WireBaseT<SoftWire> SoftWireBase;
+#else
+typedef WireBase SoftWireBase;
+#endif
+
+class SoftWire : public SoftWireBase
 {
+   friend class WireBaseT<SoftWire>;
 private:
+   typedef SOFTWIRE_TRACE_POLICY Trace;
+
    uint8_t i2c_delay;
+   uint8_t i2c_fs_delay;   // F/S-mode delay saved while the bus runs in Hs-mode
+   uint8_t i2c_hs_delay;
+   uint8_t hs_master_code;
+   bool hs_enabled;
+   bool hs_active;         // true between the master code and the next STOP
+
+#if defined(SOFTWIRE_HAS_CYCCNT)
+   // elastic timing: bus phases end at absolute cycle counter deadlines
+   struct phase_timing {
+      uint32_t low;        // SCL low phase and the conditions, 0 = delay loop
+      uint32_t high;       // SCL high phase of data and ACK bits
+      uint32_t low_min;    // shortest phases allowed after a late edge
+      uint32_t high_min;
+   };
+   uint32_t bus_hz;            // frequency last set with setClock()
+   phase_timing fs_timing;     // F/S-mode
+   phase_timing hs_timing;     // Hs-mode
+   bool phase_auto;            // phase lengths follow setClock()
+   uint32_t deadline;          // end of the current bus phase
+
+   /*
+    * Derives the phase lengths from bus_hz (see data_delay() for why a bit
+    * takes two phases)
+    */
+   void phase_from_clock();
+
+   /*
+    * Splits the period of hz into the minimum low and high times (in ns)
+    * plus an equal share of the time left each. The period is lengthened
+    * if the minimums don't fit.
+    */
+   static void phase_split(phase_timing &timing, uint32_t hz, uint32_t low_ns, uint32_t high_ns);
+
+   inline const phase_timing &timing() const { return hs_active ? hs_timing : fs_timing; }
+#endif
+
+   /*
+    * Waits for the end of the current bus phase, the edge following it
+    * starts an SCL high phase if high is set, otherwise a phase lasting the
+    * low time. In elastic mode this is an absolute deadline, so time lost to
+    * an interrupt only lengthens the phase it hit. A late phase moves the
+    * deadline instead of being made up by shortening the following ones.
+    */
+   inline void phase_delay(bool high)
+   {
+#if defined(SOFTWIRE_HAS_CYCCNT)
+      if (fs_timing.low)
+      {
+         uint32_t now;
+         while ((int32_t)(deadline - (now = DWT->CYCCNT)) > 0) {}
+         // lateness within the cost of a phase is absorbed
+         if ((int32_t)(now - deadline) > SOFTWIRE_PHASE_CYCLES)
+            deadline = now;
+         deadline += high ? timing().high : timing().low;
+         return;
+      }
+#endif
+      UNUSED(high);
+      I2C_Delay(i2c_delay);
+   }
+
+#if defined(SOFTWIRE_HAS_CYCCNT)
+   /*
+    * Makes the current phase last at least cycles from now
+    */
+   inline void phase_keep(uint32_t cycles)
+   {
+      uint32_t end = DWT->CYCCNT + cycles;
+      if ((int32_t)(end - deadline) > 0)
+         deadline = end;
+   }
+#endif
+
+   /*
+    * Called right after an edge went out. In elastic mode, the phase it
+    * starts (an SCL high phase if high is set) lasts at least its minimum
+    * time from now: an edge delayed after the wait (by an interrupt before
+    * the pin write, or a target stretching SCL) moves the deadline,
+    * otherwise the phase would be cut short.
+    */
+   inline void phase_edge(bool high)
+   {
+#if defined(SOFTWIRE_HAS_CYCCNT)
+      if (fs_timing.low)
+         phase_keep(high ? timing().high_min : timing().low_min);
+#else
+      UNUSED(high);
+#endif
+   }
+
+   /*
+    * The same after SDA changed while SCL is low, keeping the data setup time
+    */
+   inline void data_edge()
+   {
+#if defined(SOFTWIRE_HAS_CYCCNT)
+      if (fs_timing.low)
+         phase_keep(timing().low_min >> 1);
+#endif
+   }
+
+   /*
+    * Waits before changing SDA while SCL is low. In elastic mode this takes
+    * no phase of its own: the data changes in the middle of the low phase
+    * of SCL, so reading and writing a bit both take two phases.
+    */
+   inline void data_delay()
+   {
+#if defined(SOFTWIRE_HAS_CYCCNT)
+      if (fs_timing.low)
+      {
+         uint32_t mid = deadline - (timing().low >> 1);
+         while ((int32_t)(DWT->CYCCNT - mid) < 0) {}
+         return;
+      }
+#endif
+      I2C_Delay(i2c_delay);
+   }
+
+   /*
+    * Length of a bus phase (SCL low, or a condition) in CPU cycles with the
+    * current timing
+    */
+   inline uint32_t phase_length() const
+   {
+#if defined(SOFTWIRE_HAS_CYCCNT)
+      if (fs_timing.low)
+         return timing().low;
+#endif
+      return SOFTWIRE_PHASE_CYCLES + i2c_delay * SOFTWIRE_LOOP_CYCLES;
+   }
+
+   /*
+    * True if the bus phases run on cycle counter deadlines
+    */
+   inline bool elastic() const
+   {
+#if defined(SOFTWIRE_HAS_CYCCNT)
+      return fs_timing.low != 0;
+#else
+      return false;
+#endif
+   }
+
+   /*
+    * Length of the SCL high phase of a bit in CPU cycles
+    */
+   inline uint32_t high_length() const
+   {
+#if defined(SOFTWIRE_HAS_CYCCNT)
+      if (fs_timing.low)
+         return timing().high;
+#endif
+      return SOFTWIRE_PHASE_CYCLES + i2c_delay * SOFTWIRE_LOOP_CYCLES;
+   }
+
+   /*
+    * Starts the phase timing of a new transfer. Called whenever the blocking
+    * code takes the pins again, the deadline may be arbitrarily old by then.
+    * The first phase lasts the low time, which covers the bus free time.
+    */
+   inline void phase_restart()
+   {
+#if defined(SOFTWIRE_HAS_CYCCNT)
+      deadline = DWT->CYCCNT + fs_timing.low;
+#endif
+   }
+
+   // state of the asynchronous (phase stepped) engine
+   enum {
+      AS_IDLE,
+      AS_START_SDA, AS_START_SCL,
+      AS_BIT_SDA, AS_BIT_SCL_HIGH, AS_BIT_SAMPLE, AS_BIT_SCL_LOW,
+      AS_STOP_SDA, AS_STOP_SCL, AS_STOP_SDA_HIGH,
+      AS_RSTART_SDA, AS_RSTART_SCL, AS_RSTART_SDA_LOW
+   };
+   struct {
+      pin_t pin;
+      i2c_read_plan *plan;
+   } dr_slots[SOFTWIRE_MAX_DATA_READY];
+
+   /*
+    * Interrupt handler of the data ready lines
+    */
+   void dr_handler(i2c_read_plan *plan);
+
+   /*
+    * Executes a data ready plan
+    */
+   void dr_run(i2c_read_plan *plan);
+
+   // per device circuit breaker
+   enum { CB_CLOSED, CB_OPEN, CB_HALF_OPEN };
+   struct {
+      uint8_t addr;        // 0xFF if unused
+      uint8_t state;
+      uint8_t fails;       // consecutive failures
+      uint8_t backoff_exp; // back-off = cb_backoff << backoff_exp
+      uint32_t open_until;
+   } cb_slots[SOFTWIRE_BREAKER_SLOTS];
+   uint8_t cb_threshold;   // 0 = circuit breaker disabled
+   uint16_t cb_backoff;
+   uint16_t cb_max_backoff;
+   uint8_t xfer_addr;      // first device addressed in the current transfer
+
+   /*
+    * Returns false if transfers to addr have to fail fast
+    */
+   bool cb_allow(uint8_t addr);
+
+   /*
+    * Returns the slot to track a new failing device in, or
+    * SOFTWIRE_BREAKER_SLOTS if all of them are open and cooling down
+    */
+   uint8_t cb_victim();
+
+   /*
+    * Records the outcome of a transfer to addr
+    */
+   void cb_record(uint8_t addr, uint8_t stat);
+
+   volatile uint8_t as_state;
+   volatile uint8_t as_status;
+   volatile bool as_held;  // an asynchronous transfer ended with a Repeated Start
+   i2c_msg *as_msg;
+   uint8_t as_stop;
+   bool as_read;
+   bool as_ack;
+   int16_t as_byte;        // -1 while sending the address
+   uint8_t as_bit;         // 0..7 data bits, 8 ACK bit
+   uint8_t as_shift;
+   uint32_t as_stretch_t;
+   i2c_async_callback as_callback;
+   void *as_callback_arg;
+
+   uint32_t as_start;
+
+   // owner of the pins: OWNER_NONE, OWNER_ASYNC for the asynchronous
+   // engine, otherwise the context of a blocking call (see context())
+   enum { OWNER_NONE = 0, OWNER_ASYNC = 0xFFFF };
+   volatile uint16_t bus_owner;
+   uint8_t claim_depth;    // nested claims of a blocking owner
+   uint16_t lock_depth;    // SoftWire_Lock() calls of the owner, undone when it lets go
+
+   /*
+    * Calling context: 1 in thread mode, 1 + the exception number in an
+    * interrupt handler
+    */
+   static uint16_t context() { return 1 + __get_IPSR(); }
+
+   /*
+    * Takes the pins for a blocking call of the calling context. Test and
+    * set are done with interrupts masked, so neither an interrupt nor the
+    * asynchronous engine can slip in between. Nested calls of the owner
+    * succeed, and so does the owner continuing a transfer it left open.
+    * Tasks share thread mode, they are kept apart by SoftWire_Lock().
+    * With take_held, a Repeated Start held by the asynchronous engine is
+    * taken over. Returns false if the pins are owned elsewhere.
+    */
+   bool claim(bool take_held = false);
+
+   /*
+    * Gives back a claim. The owner keeps the bus (and the lock) while the
+    * transfer is left open with a Repeated Start.
+    */
+   void release();
+
+   /*
+    * Runs body as a blocking call owning the pins, returns busy without
+    * touching them if that isn't possible
+    */
+   template <class T, class F>
+   T exclusive(T busy, F body)
+   {
+      if (!claim())
+         return busy;
+      T result = body();
+      release();
+      return result;
+   }
+
+   // state of the current transfer (Start to Stop)
+   volatile bool bus_open;
+   bool scl_timeout;       // SCL has been stretched longer than STRETCH_TIMEOUT
+   uint8_t xfer_status;
+   uint16_t xfer_bytes;
+   uint32_t xfer_start;
+
+#if defined(SOFTWIRE_STATS)
+   i2c_stats stats;
+   bool stats_failing;
+   uint32_t stats_fail_since;
+
+   uint32_t xfer_phases;
+   bool xfer_timed;              // ran in one go on the delay loop, see i2c_stop()
+   uint32_t phase_ns_measured;   // running average, 0 if not measured yet
+   uint8_t phase_ns_delay;       // i2c_delay the average was measured with
+
+   uint32_t stats_start() { return micros(); }
+   void stats_count(uint16_t bytes) { xfer_bytes += bytes; }
+   void stats_phases(uint16_t phases) { xfer_phases += phases; }
+   void stats_untimed() { xfer_timed = false; }
+   void stats_record(uint8_t stat, uint16_t bytes, uint32_t start_us);
+#else
+   uint32_t stats_start() { return 0; }
+   void stats_count(uint16_t) {}
+   void stats_phases(uint16_t) {}
+   void stats_untimed() {}
+   void stats_record(uint8_t, uint16_t, uint32_t) {}
+#endif
+
+#if defined(SOFTWIRE_TIMESTAMPS)
+   i2c_timestamps stamps;
+   bool stamp_start_due;   // start is taken on the next Start condition
+   bool stamp_bit_due;     // firstBit is taken on the next rising SCL edge
+   // a transfer rejected before the Start keeps the time of the attempt
+   void stamp_attempt() { stamps.start = SOFTWIRE_CYCLES(); stamps.firstBit = 0; stamp_start_due = true; stamp_bit_due = false; }
+   void stamp_start() { if (stamp_start_due) { stamps.start = SOFTWIRE_CYCLES(); stamp_start_due = false; } }
+   void stamp_read() { stamp_bit_due = true; }
+   void stamp_first_bit() { if (stamp_bit_due) { stamps.firstBit = SOFTWIRE_CYCLES(); stamp_bit_due = false; } }
+#else
+   void stamp_attempt() {}
+   void stamp_start() {}
+   void stamp_read() {}
+   void stamp_first_bit() {}
+#endif
+
+   /*
+    * Enables the DWT cycle counter
+    */
+   static void enable_cycle_counter();
+
+#if defined(SOFTWIRE_HAS_CYCCNT)
+   /*
+    * Releases a line from low and returns the cycles until it reads high
+    * (0xFFFFFFFF on timeout)
+    */
+   uint32_t rise_cycles(PinName pin);
+#endif
+
+   /*
+    * Duration of a bus phase in ns at the given delay
+    */
+   uint32_t phase_ns(uint8_t delay) const;
+
+   /*
+    * Number of bus phases needed by a message (without the end condition)
+    */
+   static uint32_t msg_phases(const i2c_msg &msg, bool elastic = false);
+
+   /*
+    * Status of the current transfer, including stretching timeouts
+    */
+   uint8_t i2c_result();
+
+   /*
+    * Advances the asynchronous engine after a complete byte (incl. ACK)
+    */
+   void as_next_byte();
+
+   /*
+    * Finishes the asynchronous transfer and notifies the callback
+    */
+   void as_finish();
    PinName scl_pin;     // using PinName types allows the usage of digitalWriteFast() / digitalReadFast()
    PinName sda_pin;
+#if defined(SOFTWIRE_UNROLLED_SHIFT)
+   GPIO_TypeDef *sda_port;  // direct port access for the unrolled shifter
+   uint32_t sda_mask;
+#endif
+
+   uint8_t oversampling;   // samples per read of SDA/SCL, 1 = single read
+
+   /*
+    * Majority vote of several reads of a pin
+    */
+   uint8_t read_filtered(PinName pin);
+
+   /*
+    * Reads the SDA/SCL lines (1 = high), using a majority vote if
+    * oversampling is enabled
+    */
+   inline uint8_t read_sda()
+   {
+      if (oversampling > 1)
+         return read_filtered(sda_pin);
+#if defined(SOFTWIRE_UNROLLED_SHIFT)
+      return (sda_port->IDR & sda_mask) != 0;
+#else
+      return digitalReadFast(sda_pin) != LOW;
+#endif
+   }
+
+   inline uint8_t read_scl()
+   {
+      if (oversampling > 1)
+         return read_filtered(scl_pin);
+      return digitalReadFast(scl_pin) != LOW;
+   }
 
    /*
     * Sets the SCL line to HIGH/LOW and allow for clock stretching by slave
-    * devices
+    * devices. A HIGH starts the high phase of a bit, unless it's the setup
+    * of a condition (Stop, Repeated Start), which lasts the low time.
     */
-   void set_scl(bool);
+   void set_scl(bool, bool condition = false);
 
    /*
     * Sets the SDA line to HIGH/LOW
     */
    void set_sda(bool);
 
+   /*
+    * Sets the SDA line to HIGH/LOW while SCL is low (data and ACK bits)
+    */
+   void set_data(bool);
+
    /*
     * Creates a Start condition on the bus
     */
@@ -120,6 +747,13 @@ private:
     */
    void i2c_repeated_start();
 
+   /*
+    * Sends the Hs-mode master code at F/S speed and switches over to
+    * the Hs timing with a repeated start. The bus stays in Hs-mode
+    * until the next Stop condition.
+    */
+   void i2c_hs_enter();
+
    /*
     * Gets an ACK condition from a slave device on the bus
     */
@@ -145,6 +779,65 @@ private:
     */
    void i2c_shift_out(uint8_t);
 
+#if defined(SOFTWIRE_UNROLLED_SHIFT)
+   /*
+    * Single bit steps of the unrolled shifter. SDA is written through BSRR
+    * and read from IDR, so there are no data dependent branches.
+    */
+   inline void i2c_shift_out_bit(uint8_t) __attribute__((always_inline));
+   inline void i2c_shift_in_bit(uint8_t&) __attribute__((always_inline));
+#endif
+
+   /*
+    * Creates a Start condition (including the Hs-mode handshake if needed)
+    * and sends the slave address. Stops the bus and returns I2C_NACK_ADDR
+    * if the address wasn't acknowledged.
+    */
+   uint8_t i2c_address(uint8_t);
+
+   /*
+    * Shifts out a number of bytes. Stops the bus and returns I2C_NACK_DATA
+    * if a byte wasn't acknowledged. The last parameter counts the bytes sent.
+    */
+   uint8_t i2c_write_bytes(const uint8_t*, uint16_t, uint16_t&);
+
+   /*
+    * Shifts in a number of bytes, ACKing all but the last one
+    */
+   void i2c_read_bytes(uint8_t*, uint16_t);
+
+   /*
+    * Shifts in a number of bytes without taking the first bit timestamp.
+    * The last byte is only NACKed if the span ends the read.
+    */
+   void i2c_read_span(uint8_t*, uint16_t, bool);
+
+   /*
+    * Ends a transfer with either a Stop or a Repeated Start condition
+    */
+   void i2c_end(uint8_t);
+
+   /*
+    * Converts register values between the device's and the MCU's byte order.
+    * The condition is a compile time constant, so no code is generated if
+    * both byte orders are the same.
+    */
+   template <typename T, I2CByteOrder order>
+   static inline void i2c_convert_order(T *values, size_t count)
+   {
+      static constexpr bool swap = (sizeof(T) > 1) && (order != I2C_NATIVE_ORDER);
+      if (!swap)
+         return;
+      for (size_t n = 0; n < count; n++) {
+         uint8_t *b = (uint8_t*)&values[n];
+         for (size_t i = 0; i < sizeof(T) / 2; i++) {
+            uint8_t tmp = b[i];
+            b[i] = b[sizeof(T) - 1 - i];
+            b[sizeof(T) - 1 - i] = tmp;
+         }
+      }
+   }
+
 protected:
    /*
     * Processes the incoming I2C message defined by WireBase
@@ -162,15 +855,295 @@ public:
    /*
     * Sets pins SDA and SCL to OUPTUT_OPEN_DRAIN, joining I2C bus as
     * master. This function overwrites the default behaviour of
-    * .begin(uint8_t) in WireBase
+    * .begin(uint8_t) in WireBase. The pins are left alone while another
+    * context or the asynchronous engine owns the bus.
     */
    void begin(uint8_t = 0x00);
 
+   using SoftWireBase::endTransmission;
+   using SoftWireBase::requestFrom;
+
+   /*
+    * Same as endTransmission(), but leaves the bus in a Repeated Start
+    * condition if sendStop is false.
+    */
+   uint8_t endTransmission(bool sendStop);
+
+   /*
+    * Same as requestFrom(), but leaves the bus in a Repeated Start
+    * condition if sendStop is false.
+    */
+   uint8_t requestFrom(uint8_t address, uint8_t quantity, bool sendStop);
+
    /*
     * Sets the target bus speed, i.e. 400 kHz or 100 kHz.
     */
    void setClock(uint32_t frequencyHz);
 
+   /*
+    * Enables/disables Hs-mode. If enabled, each transfer starting from an
+    * idle bus is preceded by the master code (sent at F/S speed), followed
+    * by a repeated start at the Hs timing given in hsDelay. Transfers chained
+    * by repeated starts stay in Hs-mode, a Stop returns the bus to F/S-mode.
+    * Calling setClock(3400000) enables Hs-mode with the default settings.
+    */
+   void setHsMode(bool enable, uint8_t masterCode = I2C_HS_MASTER_CODE, uint8_t hsDelay = SOFT_HS);
+
+   /*
+    * Writes the register address, then reads len bytes with a repeated
+    * start directly into buf (bypassing the receive buffer).
+    * If stop is false, the bus is left in a Repeated Start condition.
+    */
+   uint8_t readRegister(uint8_t addr, uint8_t reg, uint8_t *buf, uint16_t len, bool stop = true);
+
+   /*
+    * Writes the register address followed by len bytes from buf in one
+    * transfer (bypassing the transmit buffer).
+    */
+   uint8_t writeRegister(uint8_t addr, uint8_t reg, const uint8_t *buf, uint16_t len, bool stop = true);
+
+#if defined(SOFTWIRE_HAS_CYCCNT)
+   /*
+    * Measures the rise time of SCL and SDA by releasing each line from low
+    * and counting CPU cycles until it reads high. Derives the RC time
+    * constant and (for the given pull-up resistance) the bus capacitance,
+    * and picks the smallest delay for which the rise time stays within
+    * riseFraction percent of the SCL high time. If apply is set, the delay
+    * is used from now on. In elastic mode, the phases are lengthened instead
+    * where the bus needs it (never shortened) and no longer follow
+    * setClock(). The bus must be idle; call after begin().
+    */
+   i2c_bus_info measureBus(uint32_t pullupOhms = 4700, uint8_t riseFraction = 50, bool apply = true);
+
+   /*
+    * Switches the blocking transfers from the delay loop to elastic timing:
+    * each bus phase waits for an absolute deadline on the cycle counter
+    * rather than for a fixed number of loops. An interrupt preempting a
+    * transfer only lengthens the phase it hit, the following phases run at
+    * the nominal rate again, so transfers can run with interrupts enabled.
+    * By default the low and high phases are derived from the frequency set
+    * with setClock() and keep the minimum SCL low and high times of its
+    * speed mode (I2C_xx_LOW_NS / I2C_xx_HIGH_NS), also after an interrupt or
+    * clock stretching; the bus runs slower than set if they don't fit into
+    * the period. phaseCycles overrides that with low and high phases of
+    * that many cycles, regardless of the minimums. SDA is changed in the
+    * middle of the low phase of SCL rather than in a phase of its own, so
+    * data bits run at the set frequency. The asynchronous engine is timed by
+    * the caller of step() and isn't affected.
+    */
+   void setElasticTiming(bool enable, uint32_t phaseCycles = 0);
+#endif
+
+   /*
+    * Sets the number of reads taken when sampling SDA (data and ACK bits)
+    * and SCL (clock stretching). With more than one sample, the reads are
+    * spread across the high phase (but at least SOFTWIRE_SAMPLE_SPACING_NS
+    * apart, also at the fastest clocks) and the majority wins, which filters
+    * glitches on long or noisy buses. Use an odd number, 1 disables it.
+    */
+   void setOversampling(uint8_t samples);
+
+   /*
+    * Enables the per device circuit breaker. After threshold consecutive
+    * failures (address NACK or stretching timeout) transfers to a device
+    * fail fast with I2C_NACK_ADDR, without touching the bus, for backoffMs.
+    * Afterwards a single probe transfer is let through; if it fails, the
+    * back-off doubles up to maxBackoffMs. A threshold of 0 disables it.
+    */
+   void setCircuitBreaker(uint8_t threshold, uint16_t backoffMs = 100, uint16_t maxBackoffMs = 10000);
+
+   /*
+    * True while transfers to addr are being rejected
+    */
+   bool isTripped(uint8_t addr);
+
+   /*
+    * Processes a sequence of messages chained by repeated starts, the last
+    * one ends with a Stop. Stops at the first message failing.
+    */
+   uint8_t transfer(i2c_msg *msgs, uint8_t count);
+
+   /*
+    * Ends a transfer that has been left open by one of the register
+    * functions above with stop = false. Does nothing if the bus isn't open.
+    */
+   void stop();
+
+   /*
+    * Read-modify-write of the bits given in mask. The register is read and
+    * (only if its value changes) written back without releasing the bus in
+    * between, using repeated starts. If the value is unchanged, the
+    * transfer ends after the read.
+    * Interrupt handlers get I2C_BUSY in the middle of the update, other
+    * tasks of an RTOS wait in SoftWire_Lock() (see there).
+    */
+   uint8_t updateBits(uint8_t addr, uint8_t reg, uint8_t mask, uint8_t value);
+
+   /*
+    * Executes a transaction script (see I2C_SCRIPT_xxx) directly from flash.
+    * Returns the bus status of the failing step (I2C_ERROR for a failed
+    * check, I2C_TIMEOUT for a poll timeout) and optionally its offset
+    * in the script.
+    */
+   uint8_t runScript(const uint8_t *script, uint16_t *failedAt = nullptr);
+
+   /*
+    * Starts an asynchronous transfer of msg, which is then advanced by one
+    * bus phase on each call to step() (i.e. from a timer interrupt). The bus
+    * speed is given by the step rate: one bit takes four steps.
+    * Returns I2C_BUSY if an asynchronous transfer is still running or a
+    * blocking one is running or has left the bus open. While the asynchronous engine
+    * runs, the blocking functions return I2C_BUSY (-1 / false for
+    * smbusAlertResponse() and measureBus()) without touching the pins.
+    * If stop is false, the bus stays held after the Repeated Start: the
+    * blocking functions keep returning I2C_BUSY until the next startAsync()
+    * continues the transfer and ends it with a Stop, or stop() is called.
+    * Hs-mode isn't supported by the asynchronous engine.
+    */
+   uint8_t startAsync(i2c_msg *msg, bool stop = true);
+
+   /*
+    * Advances the asynchronous transfer by one phase. Returns I2C_BUSY while
+    * the transfer is running, its final status afterwards.
+    */
+   uint8_t step();
+
+   /*
+    * True while an asynchronous transfer is running
+    */
+   bool asyncBusy() const { return as_state != AS_IDLE; }
+
+   /*
+    * Status of the last asynchronous transfer (I2C_BUSY while running)
+    */
+   uint8_t asyncStatus() const { return as_status; }
+
+   /*
+    * Sets a function being called when an asynchronous transfer completes
+    */
+   void onAsyncDone(i2c_async_callback callback, void *arg = nullptr);
+
+   /*
+    * Launches the read given in plan on each edge (mode: RISING/FALLING) of
+    * the data ready pin, either right in the interrupt or, if plan.deferred
+    * is set, on the next call to serviceDataReady(). Reads are deferred too
+    * if the edge arrives while a transfer is running.
+    * For SMBALERT lines (plan.smbalert), the Alert Response Address is
+    * queried first and the device found is stored in plan.alertAddr.
+    * Returns false if all SOFTWIRE_MAX_DATA_READY slots are in use.
+    */
+   bool attachDataReady(pin_t pin, i2c_read_plan &plan, uint32_t mode = RISING);
+   void detachDataReady(pin_t pin);
+
+   /*
+    * Executes the pending deferred reads, call it from the main loop
+    */
+   void serviceDataReady();
+
+   /*
+    * Reads the SMBus Alert Response Address. Returns the address of the
+    * device asserting SMBALERT (the one with the lowest address wins),
+    * or -1 if no device answered.
+    */
+   int16_t smbusAlertResponse();
+
+#if defined(SOFTWIRE_TIMESTAMPS)
+   /*
+    * Returns the timestamps of the last transfer, i.e. right after
+    * readRegister(). Reads of data ready plans and queued jobs store them
+    * with their result (i2c_read_plan::stamps, i2c_job::stamps).
+    */
+   const i2c_timestamps &getTimestamps() const { return stamps; }
+#endif
+
+   /*
+    * Passive sniffer mode: releases both lines (INPUT) and feeds the decoder
+    * with samples taken in a tight polling loop for durationMs. If SDA and
+    * SCL are on the same port, both are sampled with a single port read.
+    * Blocks for the whole duration, call begin() afterwards to become a
+    * bus master again. Returns the number of records decoded, or 0 without
+    * touching the pins while a transfer is running.
+    */
+   uint32_t sniff(I2CSnifferDecoder &decoder, uint32_t durationMs);
+
+   /*
+    * Estimates the bus time in microseconds a message (or a sequence of
+    * messages chained by repeated starts) takes with the current timing,
+    * including start, stop and ACK overhead.
+    */
+   uint32_t estimateDuration(const i2c_msg &msg) const;
+   uint32_t estimateDuration(const i2c_msg *msgs, uint8_t count) const;
+
+#if defined(SOFTWIRE_STATS)
+   /*
+    * Returns the transfer statistics collected since the last reset
+    */
+   const i2c_stats &getStats() const { return stats; }
+
+   /*
+    * Clears the transfer statistics
+    */
+   void resetStats();
+
+   /*
+    * Prints the statistics as a single line JSON object, i.e. for
+    * comparing throughput and recovery times between builds
+    */
+   void printStats(Print &out);
+#else
+   void resetStats() {}
+#endif
+
+   /*
+    * Typed register accessors, i.e. readReg<int16_t, I2C_BIG_ENDIAN>(addr, reg)
+    * or readRegs<int16_t, I2C_LITTLE_ENDIAN>(addr, reg, array), the array
+    * size being deduced. Values are read straight into the destination and
+    * converted to the MCU's byte order in place.
+    */
+   template <typename T, I2CByteOrder order = I2C_BIG_ENDIAN, size_t N>
+   uint8_t readRegs(uint8_t addr, uint8_t reg, T (&values)[N])
+   {
+      return readRegs<T, order>(addr, reg, values, N);
+   }
+
+   template <typename T, I2CByteOrder order = I2C_BIG_ENDIAN>
+   uint8_t readRegs(uint8_t addr, uint8_t reg, T *values, size_t count)
+   {
+      uint8_t stat = readRegister(addr, reg, (uint8_t*)values, sizeof(T) * count);
+      i2c_convert_order<T, order>(values, count);
+      return stat;
+   }
+
+   template <typename T, I2CByteOrder order = I2C_BIG_ENDIAN>
+   uint8_t readReg(uint8_t addr, uint8_t reg, T &value)
+   {
+      return readRegs<T, order>(addr, reg, &value, 1);
+   }
+
+   template <typename T, I2CByteOrder order = I2C_BIG_ENDIAN>
+   T readReg(uint8_t addr, uint8_t reg)
+   {
+      T value = T();
+      readRegs<T, order>(addr, reg, &value, 1);
+      return value;
+   }
+
+   template <typename T, I2CByteOrder order = I2C_BIG_ENDIAN, size_t N>
+   uint8_t writeRegs(uint8_t addr, uint8_t reg, const T (&values)[N])
+   {
+      T buf[N];
+      memcpy(buf, values, sizeof(buf));
+      i2c_convert_order<T, order>(buf, N);
+      return writeRegister(addr, reg, (const uint8_t*)buf, sizeof(buf));
+   }
+
+   template <typename T, I2CByteOrder order = I2C_BIG_ENDIAN>
+   uint8_t writeReg(uint8_t addr, uint8_t reg, T value)
+   {
+      i2c_convert_order<T, order>(&value, 1);
+      return writeRegister(addr, reg, (const uint8_t*)&value, sizeof(T));
+   }
+
    /*
     * Sets pins SDA and SCL to INPUT
     */
@@ -0,0 +1,87 @@
+/******************************************************************************
+ * The MIT License
+ *
+ * Copyright (c) 2026 Technik Gegg
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *****************************************************************************/
+
+/**
+ * @file SoftWireFifo.cpp
+ * @brief Drains the hardware FIFO of sensors (i.e. MPU6050, ICM-20948) or
+ *        ADCs into a lock-free single-producer / single-consumer ring buffer.
+ */
+
+#include "SoftWireFifo.h"
+
+SoftWireFifo::SoftWireFifo(SoftWire &bus, const i2c_fifo_config &config, I2CRingBuffer &ring)
+    : bus(bus), config(config), ring(ring), overflow_cnt(0)
+{
+}
+
+uint8_t SoftWireFifo::drain()
+{
+    uint8_t raw[2] = { 0, 0 };
+    uint8_t stat = bus.readRegister(config.addr, config.countReg, raw, config.countBytes, false);
+    if (stat != I2C_OK)
+    {
+        // a timeout leaves the bus in the repeated start
+        bus.stop();
+        return stat;
+    }
+
+    uint16_t level = raw[0];
+    if (config.countBytes == 2)
+    {
+        level = (config.countOrder == I2C_BIG_ENDIAN) ? (raw[0] << 8) | raw[1] : (raw[1] << 8) | raw[0];
+    }
+    level &= config.countMask;
+    uint16_t pending = config.countInSamples ? level : level / ring.sampleSize();
+
+    uint16_t space = ring.space();
+    if (pending > space)
+    {
+        overflow_cnt++;
+        pending = space;
+    }
+    if (pending == 0)
+    {
+        bus.stop();
+        return I2C_OK;
+    }
+    // at most two bursts, if the samples wrap around the end of the ring buffer
+    while (pending)
+    {
+        uint16_t count;
+        uint8_t *ptr = ring.writeSpan(count);
+        if (count > pending)
+            count = pending;
+        pending -= count;
+        stat = bus.readRegister(config.addr, config.dataReg, ptr, count * ring.sampleSize(), pending == 0);
+        if (stat != I2C_OK)
+        {
+            bus.stop();
+            return stat;
+        }
+        ring.commit(count);
+    }
+    return I2C_OK;
+}
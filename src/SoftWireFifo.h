@@ -0,0 +1,81 @@
+/******************************************************************************
+ * The MIT License
+ *
+ * Copyright (c) 2026 Technik Gegg
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *****************************************************************************/
+
+/**
+ * @file SoftWireFifo.h
+ * @brief Drains the hardware FIFO of sensors (i.e. MPU6050, ICM-20948) or
+ *        ADCs into a lock-free single-producer / single-consumer ring buffer.
+ */
+
+/*
+ * The producer (SoftWireFifo::drain(), usually called from a timer or the
+ * main loop) and the consumer (the code processing the samples) may run in
+ * different contexts without any locking, as long as there's only one of each.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "SoftWire.h"
+#include "I2CRingBuffer.h"
+
+/**
+ * @brief Description of a device FIFO
+ */
+typedef struct i2c_fifo_config {
+    uint8_t     addr;               /**< Device address */
+    uint8_t     countReg;           /**< FIFO level register */
+    uint8_t     countBytes;         /**< Size of the level register (1 or 2) */
+    I2CByteOrder countOrder;        /**< Byte order of the level register */
+    uint16_t    countMask;          /**< Valid bits of the level register */
+    bool        countInSamples;     /**< Level is given in samples rather than bytes */
+    uint8_t     dataReg;            /**< FIFO data register */
+} i2c_fifo_config;
+
+class SoftWireFifo {
+private:
+    SoftWire &bus;
+    i2c_fifo_config config;
+    I2CRingBuffer &ring;
+    uint32_t overflow_cnt;
+
+public:
+    SoftWireFifo(SoftWire &bus, const i2c_fifo_config &config, I2CRingBuffer &ring);
+
+    /*
+     * Reads the FIFO level and all complete samples in one combined transfer
+     * (using repeated starts). Samples that don't fit into the ring buffer
+     * are left in the device and counted as overflow.
+     * Returns the bus status, the bus is always released.
+     */
+    uint8_t drain();
+
+    /*
+     * Number of drain() calls which couldn't fetch all pending samples
+     */
+    uint32_t overflows() const { return overflow_cnt; }
+    void clearOverflows() { overflow_cnt = 0; }
+};
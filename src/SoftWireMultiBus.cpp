@@ -0,0 +1,76 @@
+/******************************************************************************
+ * The MIT License
+ *
+ * Copyright (c) 2026 Technik Gegg
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *****************************************************************************/
+
+/**
+ * @file SoftWireMultiBus.cpp
+ * @brief Runs the asynchronous engines of several SoftWire buses from a
+ *        single timer interrupt.
+ */
+
+#include "SoftWireMultiBus.h"
+
+SoftWireMultiBus::SoftWireMultiBus() : bus_cnt(0)
+{
+}
+
+bool SoftWireMultiBus::attach(SoftWire &bus)
+{
+    if (bus_cnt == SOFTWIRE_MAX_BUSES)
+        return false;
+    buses[bus_cnt++] = &bus;
+    return true;
+}
+
+void SoftWireMultiBus::detach(SoftWire &bus)
+{
+    for (uint8_t i = 0; i < bus_cnt; i++)
+    {
+        if (buses[i] == &bus)
+        {
+            buses[i] = buses[--bus_cnt];
+            return;
+        }
+    }
+}
+
+void SoftWireMultiBus::tick()
+{
+    for (uint8_t i = 0; i < bus_cnt; i++)
+    {
+        if (buses[i]->asyncBusy())
+            buses[i]->step();
+    }
+}
+
+bool SoftWireMultiBus::busy() const
+{
+    for (uint8_t i = 0; i < bus_cnt; i++)
+    {
+        if (buses[i]->asyncBusy())
+            return true;
+    }
+    return false;
+}
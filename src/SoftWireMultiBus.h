@@ -0,0 +1,88 @@
+/******************************************************************************
+ * The MIT License
+ *
+ * Copyright (c) 2026 Technik Gegg
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *****************************************************************************/
+
+/**
+ * @file SoftWireMultiBus.h
+ * @brief Runs the asynchronous engines of several SoftWire buses from a
+ *        single timer interrupt.
+ */
+
+/*
+ * Each tick() advances every bus with a running transfer by one phase, so
+ * transfers on different buses proceed concurrently. One bit takes four
+ * ticks, i.e. a 400 kHz tick rate results in 100 kHz on each bus.
+ *
+ *   SoftWireMultiBus buses;
+ *   HardwareTimer timer(TIM2);
+ *
+ *   buses.attach(bus1);
+ *   buses.attach(bus2);
+ *   timer.setOverflow(400000, HERTZ_FORMAT);
+ *   timer.attachInterrupt([]() { buses.tick(); });
+ *   timer.resume();
+ *   ...
+ *   bus1.startAsync(&msg1);
+ *   bus2.startAsync(&msg2);
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "SoftWire.h"
+
+#ifndef SOFTWIRE_MAX_BUSES
+#define SOFTWIRE_MAX_BUSES  4
+#endif
+
+class SoftWireMultiBus {
+private:
+    SoftWire *buses[SOFTWIRE_MAX_BUSES];
+    uint8_t bus_cnt;
+
+public:
+    SoftWireMultiBus();
+
+    /*
+     * Adds a bus to the dispatcher. Returns false if there's no room left.
+     */
+    bool attach(SoftWire &bus);
+
+    /*
+     * Removes a bus from the dispatcher
+     */
+    void detach(SoftWire &bus);
+
+    /*
+     * Advances each bus with a running transfer by one phase.
+     * To be called from the timer interrupt.
+     */
+    void tick();
+
+    /*
+     * True while any of the buses has a running transfer
+     */
+    bool busy() const;
+};
@@ -0,0 +1,146 @@
+/******************************************************************************
+ * The MIT License
+ *
+ * Copyright (c) 2026 Technik Gegg
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *****************************************************************************/
+
+/**
+ * @file SoftWireMux.cpp
+ * @brief Access to devices behind TCA9548A/PCA954x I2C multiplexers.
+ */
+
+#include "SoftWireMux.h"
+
+SoftWireMux::SoftWireMux(SoftWire &bus) : bus(bus), mux_cnt(0)
+{
+}
+
+int8_t SoftWireMux::addMux(uint8_t addr, I2CMuxType type)
+{
+    if (mux_cnt == SOFTWIRE_MAX_MUXES)
+        return -1;
+    muxes[mux_cnt].addr = addr;
+    muxes[mux_cnt].type = type;
+    muxes[mux_cnt].ctrl = -1;
+    return mux_cnt++;
+}
+
+void SoftWireMux::invalidate()
+{
+    for (uint8_t i = 0; i < mux_cnt; i++)
+        muxes[i].ctrl = -1;
+}
+
+uint8_t SoftWireMux::set_ctrl(uint8_t mux, uint8_t ctrl)
+{
+    if (muxes[mux].ctrl == ctrl)
+        return I2C_OK;
+    i2c_msg msg;
+    msg.addr = muxes[mux].addr;
+    msg.flags = 0;
+    msg.length = 1;
+    msg.data = &ctrl;
+    uint8_t stat = bus.transfer(&msg, 1);
+    muxes[mux].ctrl = (stat == I2C_OK) ? ctrl : -1;
+    return stat;
+}
+
+uint8_t SoftWireMux::select(uint8_t mux, uint8_t channel)
+{
+    if (mux == I2C_MUX_NONE)
+    {
+        // main bus only: an open channel could hide an identical device
+        for (uint8_t i = 0; i < mux_cnt; i++)
+        {
+            uint8_t stat = set_ctrl(i, 0);
+            if (stat != I2C_OK)
+                return stat;
+        }
+        return I2C_OK;
+    }
+    // a mux never registered, or a channel the flavour doesn't have
+    if (mux >= mux_cnt)
+        return I2C_ERROR;
+    bool numbered = (muxes[mux].type == I2C_MUX_PCA9544);
+    if (channel >= (numbered ? 4 : 8))
+        return I2C_ERROR;
+    uint8_t ctrl = numbered ? (0x04 | channel) : (1 << channel);
+    if (muxes[mux].ctrl == ctrl)
+        return I2C_OK;
+    // disable the other multiplexers first
+    for (uint8_t i = 0; i < mux_cnt; i++)
+    {
+        if (i == mux)
+            continue;
+        uint8_t stat = set_ctrl(i, 0);
+        if (stat != I2C_OK)
+            return stat;
+    }
+    return set_ctrl(mux, ctrl);
+}
+
+uint8_t SoftWireMux::readRegister(const i2c_mux_device &dev, uint8_t reg, uint8_t *data, uint16_t length)
+{
+    uint8_t stat = select(dev.mux, dev.channel);
+    if (stat != I2C_OK)
+        return stat;
+    return bus.readRegister(dev.addr, reg, data, length);
+}
+
+uint8_t SoftWireMux::writeRegister(const i2c_mux_device &dev, uint8_t reg, const uint8_t *data, uint16_t length)
+{
+    uint8_t stat = select(dev.mux, dev.channel);
+    if (stat != I2C_OK)
+        return stat;
+    return bus.writeRegister(dev.addr, reg, data, length);
+}
+
+uint8_t SoftWireMux::runBatch(i2c_mux_job *jobs, uint8_t count)
+{
+    // stable insertion sort by (mux, channel), devices on the main bus
+    // (I2C_MUX_NONE) come last
+    for (uint8_t i = 1; i < count; i++)
+    {
+        i2c_mux_job job = jobs[i];
+        uint16_t key = (job.dev.mux << 8) | job.dev.channel;
+        uint8_t j = i;
+        while (j > 0 && ((jobs[j - 1].dev.mux << 8) | jobs[j - 1].dev.channel) > key)
+        {
+            jobs[j] = jobs[j - 1];
+            j--;
+        }
+        jobs[j] = job;
+    }
+    uint8_t result = I2C_OK;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        i2c_mux_job &job = jobs[i];
+        if (job.read)
+            job.status = readRegister(job.dev, job.reg, job.data, job.length);
+        else
+            job.status = writeRegister(job.dev, job.reg, job.data, job.length);
+        if (result == I2C_OK)
+            result = job.status;
+    }
+    return result;
+}
@@ -0,0 +1,130 @@
+/******************************************************************************
+ * The MIT License
+ *
+ * Copyright (c) 2026 Technik Gegg
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *****************************************************************************/
+
+/**
+ * @file SoftWireMux.h
+ * @brief Access to devices behind TCA9548A/PCA954x I2C multiplexers.
+ */
+
+/*
+ * Devices are addressed as (mux, channel, address). The channel currently
+ * selected on each multiplexer is cached, so the control register is only
+ * written when the channel actually changes. When switching channels, all
+ * other multiplexers are disabled, in order to avoid address conflicts
+ * between identical devices behind different multiplexers.
+ * Batches of accesses are grouped by channel before being executed.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "SoftWire.h"
+
+#ifndef SOFTWIRE_MAX_MUXES
+#define SOFTWIRE_MAX_MUXES      4
+#endif
+
+#define I2C_MUX_NONE            0xFF    // device sits on the main bus
+
+/**
+ * @brief Multiplexer flavours
+ */
+enum I2CMuxType {
+    I2C_MUX_PCA9548,            /**< TCA9548A/PCA9548/PCA9546: one bit per channel */
+    I2C_MUX_PCA9544             /**< PCA9544/PCA9542: channel number plus enable bit */
+};
+
+/**
+ * @brief Device behind a multiplexer
+ */
+typedef struct i2c_mux_device {
+    uint8_t     mux;                /**< Index returned by addMux() or I2C_MUX_NONE */
+    uint8_t     channel;            /**< Channel of the multiplexer */
+    uint8_t     addr;               /**< Device address */
+} i2c_mux_device;
+
+/**
+ * @brief Register access for SoftWireMux::runBatch()
+ */
+typedef struct i2c_mux_job {
+    i2c_mux_device dev;             /**< Device */
+    uint8_t     reg;                /**< Register address */
+    uint8_t     *data;              /**< Data to write or destination of the read */
+    uint16_t    length;             /**< Number of bytes */
+    bool        read;               /**< Read (true) or write (false) */
+    uint8_t     status;             /**< Bus status after execution */
+} i2c_mux_job;
+
+class SoftWireMux {
+private:
+    SoftWire &bus;
+    struct {
+        uint8_t addr;
+        uint8_t type;
+        int16_t ctrl;       // cached control register, -1 if unknown
+    } muxes[SOFTWIRE_MAX_MUXES];
+    uint8_t mux_cnt;
+
+    /*
+     * Writes the control register of a multiplexer, if it's different
+     * from the cached value
+     */
+    uint8_t set_ctrl(uint8_t mux, uint8_t ctrl);
+
+public:
+    SoftWireMux(SoftWire &bus);
+
+    /*
+     * Registers a multiplexer. Returns its index, or -1 if there's no room.
+     */
+    int8_t addMux(uint8_t addr, I2CMuxType type = I2C_MUX_PCA9548);
+
+    /*
+     * Selects the channel (skipped if it's already selected). I2C_MUX_NONE
+     * disables all multiplexers, leaving only the main bus. Returns
+     * I2C_ERROR without touching the bus if mux wasn't returned by addMux()
+     * or the channel is out of range (0..7, or 0..3 for I2C_MUX_PCA9544).
+     */
+    uint8_t select(uint8_t mux, uint8_t channel);
+
+    /*
+     * Selects the device's channel and accesses its registers
+     */
+    uint8_t readRegister(const i2c_mux_device &dev, uint8_t reg, uint8_t *data, uint16_t length);
+    uint8_t writeRegister(const i2c_mux_device &dev, uint8_t reg, const uint8_t *data, uint16_t length);
+
+    /*
+     * Executes a batch of accesses, grouped by multiplexer and channel.
+     * The jobs array is reordered in place (stable, so accesses to the same
+     * channel keep their order). Returns the first error, if any.
+     */
+    uint8_t runBatch(i2c_mux_job *jobs, uint8_t count);
+
+    /*
+     * Forgets the cached channel selections, i.e. after resetting a mux
+     */
+    void invalidate();
+};
@@ -0,0 +1,97 @@
+/******************************************************************************
+ * The MIT License
+ *
+ * Copyright (c) 2026 Technik Gegg
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *****************************************************************************/
+
+/**
+ * @file SoftWirePingPong.cpp
+ * @brief Double buffered (ping-pong) continuous acquisition on a SoftWire bus.
+ */
+
+#include "SoftWirePingPong.h"
+
+SoftWirePingPong::SoftWirePingPong(SoftWire &bus, uint8_t addr, uint8_t reg,
+                                   uint8_t *bufferA, uint8_t *bufferB, uint16_t blockLen, uint16_t chunkLen)
+    : bus(bus), addr(addr), reg(reg), block_len(blockLen), chunk_len(chunkLen),
+      overrun_cnt(0), callback(nullptr), callback_arg(nullptr)
+{
+    buffers[0] = bufferA;
+    buffers[1] = bufferB;
+    reset();
+}
+
+void SoftWirePingPong::onBlock(i2c_block_callback callback, void *arg)
+{
+    this->callback = callback;
+    callback_arg = arg;
+}
+
+void SoftWirePingPong::reset()
+{
+    fill_idx = 0;
+    fill_pos = 0;
+    ready[0] = false;
+    ready[1] = false;
+}
+
+uint8_t SoftWirePingPong::poll()
+{
+    // the last chunk never reaches past the end of the block
+    uint16_t len = block_len - fill_pos;
+    if (len > chunk_len)
+        len = chunk_len;
+    uint8_t stat = bus.readRegister(addr, reg, &buffers[fill_idx][fill_pos], len);
+    if (stat != I2C_OK)
+        return stat;
+    fill_pos += len;
+    if (fill_pos < block_len)
+        return I2C_OK;
+
+    fill_pos = 0;
+    uint8_t next = fill_idx ^ 1;
+    if (ready[next])
+    {
+        // consumer still owns the other buffer, drop this block and refill
+        overrun_cnt++;
+        return I2C_OK;
+    }
+    ready[fill_idx] = true;
+    uint8_t done = fill_idx;
+    fill_idx = next;
+    if (callback)
+        callback(buffers[done], block_len, callback_arg);
+    return I2C_OK;
+}
+
+uint8_t *SoftWirePingPong::readyBlock()
+{
+    // the complete block is always the one not being filled
+    uint8_t idx = fill_idx ^ 1;
+    return ready[idx] ? buffers[idx] : nullptr;
+}
+
+void SoftWirePingPong::release()
+{
+    ready[fill_idx ^ 1] = false;
+}
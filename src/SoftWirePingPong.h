@@ -0,0 +1,104 @@
+/******************************************************************************
+ * The MIT License
+ *
+ * Copyright (c) 2026 Technik Gegg
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *****************************************************************************/
+
+/**
+ * @file SoftWirePingPong.h
+ * @brief Double buffered (ping-pong) continuous acquisition on a SoftWire bus.
+ */
+
+/*
+ * While the application processes one block, the next block is being read
+ * into the other buffer. Each call to poll() reads one chunk (i.e. one sample)
+ * from the device. When a block is complete, the buffers are swapped and the
+ * block is signalled through readyBlock() and the optional callback.
+ * poll() can be called from the main loop or from a timer interrupt.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "SoftWire.h"
+
+typedef void (*i2c_block_callback)(uint8_t *block, uint16_t length, void *arg);
+
+class SoftWirePingPong {
+private:
+    SoftWire &bus;
+    uint8_t addr;
+    uint8_t reg;
+    uint8_t *buffers[2];
+    uint16_t block_len;
+    uint16_t chunk_len;
+    uint16_t fill_pos;
+    uint8_t fill_idx;                // buffer being filled by poll()
+    volatile bool ready[2];         // buffer holds a complete, unreleased block
+    uint32_t overrun_cnt;
+    i2c_block_callback callback;
+    void *callback_arg;
+
+public:
+    /*
+     * Each poll() reads chunkLen bytes starting at register reg. If blockLen
+     * isn't a multiple of chunkLen, the last chunk of each block is shortened
+     * to the bytes left.
+     */
+    SoftWirePingPong(SoftWire &bus, uint8_t addr, uint8_t reg,
+                     uint8_t *bufferA, uint8_t *bufferB, uint16_t blockLen, uint16_t chunkLen);
+
+    /*
+     * Sets a function being called each time a block is complete. If poll()
+     * is called from an interrupt, so is the callback.
+     */
+    void onBlock(i2c_block_callback callback, void *arg = nullptr);
+
+    /*
+     * Reads the next chunk and swaps the buffers if the block is complete.
+     * Returns the bus status.
+     */
+    uint8_t poll();
+
+    /*
+     * Returns the oldest complete block or nullptr if there's none.
+     * The block stays valid until release() gets called.
+     */
+    uint8_t *readyBlock();
+
+    /*
+     * Hands the block returned by readyBlock() back for acquisition
+     */
+    void release();
+
+    /*
+     * Number of blocks dropped because the consumer didn't release the
+     * other buffer in time
+     */
+    uint32_t overruns() const { return overrun_cnt; }
+
+    /*
+     * Discards any partially read or unreleased block
+     */
+    void reset();
+};
@@ -0,0 +1,268 @@
+/******************************************************************************
+ * The MIT License
+ *
+ * Copyright (c) 2026 Technik Gegg
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *****************************************************************************/
+
+/**
+ * @file SoftWireQueue.h
+ * @brief Lock-free submission queue, allowing transfers to be requested
+ *        from interrupt handlers without blocking.
+ */
+
+/*
+ * Jobs are taken from a fixed pool of N descriptors, filled in and submitted
+ * from any context (multiple producers). A single consumer executes them,
+ * either blocking through drain() in a worker context (i.e. the main loop),
+ * or on the asynchronous engine through pump(), which has to be called
+ * periodically after SoftWire::step() (i.e. from the same timer interrupt).
+ * Don't mix both on the same queue.
+ *
+ * Completion is signalled per job through its status (I2C_BUSY until done),
+ * the done flag and the optional callback. Jobs have to be handed back with
+ * release(), unless autoRelease is set.
+ *
+ * The queue relies on atomic read-modify-write operations, hence needs a
+ * Cortex-M3 or above (LDREX/STREX).
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include "SoftWire.h"
+
+/**
+ * @brief Transfer descriptor of the submission queue
+ */
+typedef struct i2c_job {
+    i2c_msg     msgs[2];            /**< Register write (optional) and data message */
+    uint8_t     msg_cnt;            /**< Number of messages used */
+    uint8_t     msg_idx;            /**< Message being processed (async) */
+    uint8_t     reg;                /**< Register address sent by msgs[0] of a register read */
+    bool        autoRelease;        /**< Hand back to the pool after completion */
+    void        (*callback)(struct i2c_job *job);   /**< Completion callback (optional) */
+    void        *arg;               /**< User data for the callback */
+    volatile uint8_t status;        /**< I2C_BUSY until completed */
+    volatile bool    done;          /**< Set on completion */
+#if defined(SOFTWIRE_TIMESTAMPS)
+    i2c_timestamps   stamps;        /**< Timestamps of the transfer */
+#endif
+} i2c_job;
+
+template <uint8_t N>
+class SoftWireQueue {
+    static_assert(N > 0 && N <= 32 && (N & (N - 1)) == 0, "queue size must be a power of two up to 32");
+private:
+    SoftWire &bus;
+    i2c_job jobs[N];
+    std::atomic<uint32_t> free_map;         // one bit per free descriptor
+    std::atomic<i2c_job*> slots[N];         // submitted jobs, nullptr if empty
+    std::atomic<uint32_t> tail;             // next slot to fill, shared by the producers
+    uint32_t head;                          // next slot to take, consumer only
+    i2c_job *current;                       // job on the asynchronous engine
+    bool started;                           // current has been handed to the engine
+
+    i2c_job *pop()
+    {
+        i2c_job *job = slots[head & (N - 1)].load(std::memory_order_acquire);
+        if (job == nullptr)
+            return nullptr;     // empty, or the producer hasn't published yet
+        slots[head & (N - 1)].store(nullptr, std::memory_order_relaxed);
+        head++;
+        return job;
+    }
+
+    void complete(i2c_job *job, uint8_t status)
+    {
+#if defined(SOFTWIRE_TIMESTAMPS)
+        job->stamps = bus.getTimestamps();
+#endif
+        job->status = status;
+        job->done = true;
+        if (job->callback)
+            job->callback(job);
+        if (job->autoRelease)
+            release(job);
+    }
+
+    /*
+     * Hands message idx of the current job to the asynchronous engine
+     */
+    uint8_t start(uint8_t idx)
+    {
+        uint8_t status = bus.startAsync(&current->msgs[idx], idx == current->msg_cnt - 1);
+        if (status == I2C_OK)
+        {
+            current->msg_idx = idx;
+            started = true;
+        }
+        return status;
+    }
+
+    i2c_job *prepare(uint8_t addr, uint8_t *data, uint16_t length, uint16_t flags)
+    {
+        i2c_job *job = alloc();
+        if (job == nullptr)
+            return nullptr;
+        job->msg_cnt = 1;
+        job->msgs[0].addr = addr;
+        job->msgs[0].flags = flags;
+        job->msgs[0].data = data;
+        job->msgs[0].length = length;
+        job->callback = nullptr;
+        job->arg = nullptr;
+        job->autoRelease = false;
+        return job;
+    }
+
+public:
+    SoftWireQueue(SoftWire &bus) : bus(bus), free_map(N == 32 ? 0xFFFFFFFFUL : (1UL << N) - 1), tail(0), head(0), current(nullptr), started(false)
+    {
+        for (uint8_t i = 0; i < N; i++)
+            slots[i].store(nullptr, std::memory_order_relaxed);
+    }
+
+    /*
+     * Takes a descriptor from the pool, nullptr if all are in use. ISR safe.
+     */
+    i2c_job *alloc()
+    {
+        uint32_t map = free_map.load(std::memory_order_relaxed);
+        while (map)
+        {
+            uint32_t bit = map & (~map + 1);
+            if (free_map.compare_exchange_weak(map, map & ~bit, std::memory_order_acquire))
+                return &jobs[__builtin_ctz(bit)];
+        }
+        return nullptr;
+    }
+
+    /*
+     * Hands a descriptor back to the pool. ISR safe.
+     */
+    void release(i2c_job *job)
+    {
+        free_map.fetch_or(1UL << (job - jobs), std::memory_order_release);
+    }
+
+    /*
+     * Queues a descriptor taken from alloc(). ISR safe.
+     * There can't be more jobs queued than descriptors, so this never fails.
+     */
+    void submit(i2c_job *job)
+    {
+        job->status = I2C_BUSY;
+        job->done = false;
+        job->msg_idx = 0;
+        uint32_t idx = tail.fetch_add(1, std::memory_order_relaxed);
+        slots[idx & (N - 1)].store(job, std::memory_order_release);
+    }
+
+    /*
+     * Convenience functions: allocate, set up and submit a register read /
+     * plain write. Return nullptr if the pool is exhausted. ISR safe.
+     */
+    i2c_job *readRegister(uint8_t addr, uint8_t reg, uint8_t *data, uint16_t length,
+                          void (*callback)(i2c_job*) = nullptr, void *arg = nullptr)
+    {
+        i2c_job *job = prepare(addr, nullptr, 1, 0);
+        if (job == nullptr)
+            return nullptr;
+        job->reg = reg;
+        job->msgs[0].data = &job->reg;
+        job->msgs[1].addr = addr;
+        job->msgs[1].flags = I2C_MSG_READ;
+        job->msgs[1].data = data;
+        job->msgs[1].length = length;
+        job->msg_cnt = 2;
+        job->callback = callback;
+        job->arg = arg;
+        submit(job);
+        return job;
+    }
+
+    i2c_job *write(uint8_t addr, uint8_t *data, uint16_t length,
+                   void (*callback)(i2c_job*) = nullptr, void *arg = nullptr)
+    {
+        i2c_job *job = prepare(addr, data, length, 0);
+        if (job == nullptr)
+            return nullptr;
+        job->callback = callback;
+        job->arg = arg;
+        submit(job);
+        return job;
+    }
+
+    /*
+     * Executes all queued jobs on the blocking engine (worker context)
+     */
+    void drain()
+    {
+        i2c_job *job;
+        while ((job = pop()) != nullptr)
+            complete(job, bus.transfer(job->msgs, job->msg_cnt));
+    }
+
+    /*
+     * Advances the queue on the asynchronous engine: completes the current
+     * job once the engine is idle and starts the next message or job.
+     * While the bus is busy, starting is retried on the next call; a job
+     * the engine refuses otherwise (i.e. a device tripped by the circuit
+     * breaker) completes with that status.
+     */
+    void pump()
+    {
+        if (bus.asyncBusy())
+            return;
+        if (current && started)
+        {
+            uint8_t status = bus.asyncStatus();
+            if (status == I2C_OK && current->msg_idx + 1 < current->msg_cnt)
+            {
+                // retried on the next call while the bus is busy
+                status = start(current->msg_idx + 1);
+                if (status == I2C_OK || status == I2C_BUSY)
+                    return;
+                bus.stop();     // release the repeated start of the previous message
+            }
+            complete(current, status);
+            current = nullptr;
+        }
+        if (current == nullptr)
+        {
+            current = pop();
+            started = false;
+        }
+        if (current)
+        {
+            uint8_t status = start(0);
+            if (status != I2C_OK && status != I2C_BUSY)
+            {
+                // i.e. rejected by the circuit breaker
+                complete(current, status);
+                current = nullptr;
+            }
+        }
+    }
+};
@@ -0,0 +1,92 @@
+/******************************************************************************
+ * The MIT License
+ *
+ * Copyright (c) 2026 Technik Gegg
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *****************************************************************************/
+
+/**
+ * @file SoftWireStream.h
+ * @brief Presents a SoftWire bus with the TwoWire interface, as a Stream.
+ */
+
+/*
+ * Many Arduino drivers are written against the TwoWire interface (usually
+ * templated on the Wire type or taking a Stream). This adapter provides that
+ * interface on top of SoftWire, with the bulk functions mapped to the direct
+ * buffer paths instead of per byte calls.
+ *
+ * Please note: the adapter can't be passed as TwoWire&, since TwoWire doesn't
+ * declare beginTransmission()/endTransmission()/requestFrom() virtual, so a
+ * derived class couldn't redirect them anyway.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "SoftWire.h"
+
+class SoftWireStream : public Stream {
+private:
+    SoftWire &bus;
+
+public:
+    SoftWireStream(SoftWire &bus) : bus(bus) {}
+
+    void begin() { bus.begin(); }
+    void end() { bus.end(); }
+    void setClock(uint32_t frequencyHz) { bus.setClock(frequencyHz); }
+
+    void beginTransmission(uint8_t address) { bus.beginTransmission(address); }
+    void beginTransmission(int address) { bus.beginTransmission(address); }
+
+    uint8_t endTransmission() { return bus.endTransmission(true); }
+    uint8_t endTransmission(uint8_t sendStop) { return bus.endTransmission(sendStop != 0); }
+
+    // like TwoWire, unread bytes are dropped and the number of bytes
+    // received is returned
+    uint8_t requestFrom(uint8_t address, uint8_t quantity, uint8_t sendStop = true)
+    {
+        while (bus.available())
+            bus.read();
+        return bus.requestFrom(address, quantity, sendStop != 0);
+    }
+    uint8_t requestFrom(int address, int quantity) { return requestFrom((uint8_t)address, (uint8_t)quantity); }
+    uint8_t requestFrom(int address, int quantity, int sendStop)
+    {
+        return requestFrom((uint8_t)address, (uint8_t)quantity, (uint8_t)sendStop);
+    }
+
+    // Print
+    size_t write(uint8_t value) override { return bus.writeBytes(&value, 1); }
+    size_t write(const uint8_t *buf, size_t len) override { return bus.writeBytes(buf, len); }
+    using Print::write;
+
+    // Stream
+    int available() override { return bus.available(); }
+    int read() override { return bus.available() ? bus.read() : -1; }
+    int peek() override { return bus.peek(); }
+    void flush() override {}
+
+    size_t readBytes(uint8_t *buf, size_t len) { return bus.readBytes(buf, len); }
+    size_t readBytes(char *buf, size_t len) { return bus.readBytes((uint8_t*)buf, len); }
+};
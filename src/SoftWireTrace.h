@@ -0,0 +1,73 @@
+/******************************************************************************
+ * The MIT License
+ *
+ * Copyright (c) 2026 Technik Gegg
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *****************************************************************************/
+
+/**
+ * @file SoftWireTrace.h
+ * @brief Compile time tracing hooks of SoftWire.
+ */
+
+/*
+ * SoftWire calls the static functions of a trace policy class on each bus
+ * event. The default policy consists of empty inline functions, so the hooks
+ * compile away completely. To plug in your own policy (i.e. toggling a GPIO
+ * for triggering a scope, counting events or filling a trace buffer), add
+ * something like this to your build flags:
+ *
+ *   -DSOFTWIRE_TRACE_INCLUDE=\"MyTrace.h\" -DSOFTWIRE_TRACE_POLICY=MyTrace
+ *
+ * with MyTrace.h declaring a class providing the same static functions as
+ * SoftWireNoTrace below. The hooks run right inside the bit timing, so keep
+ * them short.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+class SoftWire;
+
+struct SoftWireNoTrace {
+    // Start or Repeated Start condition
+    static inline void onStart(const SoftWire * /* bus */) {}
+    // Slave address (incl. R/W bit) sent and whether it has been ACKed
+    static inline void onAddress(const SoftWire * /* bus */, uint8_t /* sla_addr */, bool /* ack */) {}
+    // Data byte sent or received
+    static inline void onByte(const SoftWire * /* bus */, uint8_t /* value */, bool /* read */) {}
+    // ACK bit received from the slave (read = false) or sent by the master
+    static inline void onAck(const SoftWire * /* bus */, bool /* ack */, bool /* read */) {}
+    // Stop condition
+    static inline void onStop(const SoftWire * /* bus */) {}
+    // Slave is stretching SCL (timeout = true if STRETCH_TIMEOUT expired)
+    static inline void onStretch(const SoftWire * /* bus */, bool /* timeout */) {}
+};
+
+#if defined(SOFTWIRE_TRACE_INCLUDE)
+#include SOFTWIRE_TRACE_INCLUDE
+#endif
+
+#ifndef SOFTWIRE_TRACE_POLICY
+#define SOFTWIRE_TRACE_POLICY   SoftWireNoTrace
+#endif
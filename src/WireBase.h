@@ -49,6 +49,7 @@
 
 /*
  * Library ported to Arduino Core STM32 2022-04-14 Technik Gegg
+ * Split into the CRTP base WireBaseT and the polymorphic WireBase 2026-10-17 Technik Gegg
  */
 
 #pragma once
@@ -58,6 +59,13 @@
 
 #define I2C_MSG_READ            0x1
 #define I2C_MSG_10BIT_ADDR      0x2
+#define I2C_MSG_RING            0x8     /* data lies in rx_buf and wraps at its end */
+
+// the receive ring uses free running 8-bit indices and masks them
+static_assert((I2C_TXRX_BUFFER_SIZE & (I2C_TXRX_BUFFER_SIZE - 1)) == 0 &&
+              I2C_TXRX_BUFFER_SIZE <= 128,
+              "I2C_TXRX_BUFFER_SIZE must be a power of two no larger than 128");
+#define I2C_RX_MASK             (I2C_TXRX_BUFFER_SIZE - 1)
 
 /**
  * @brief I2C message type
@@ -66,35 +74,101 @@ typedef struct i2c_msg {
     uint16_t    addr;                /**< Address */
     uint16_t    flags;              /**< Bitwise OR of:
                                         - I2C_MSG_READ (write is default)
-                                        - I2C_MSG_10BIT_ADDR (7-bit is default) */
+                                        - I2C_MSG_10BIT_ADDR (7-bit is default)
+                                        - I2C_MSG_RING (internal, requestFrom
+                                          if the derived class sets rx_ring) */
     uint16_t    length;              /**< Message length */
     uint16_t    xferred;             /**< Messages transferred */
     uint8_t     *data;               /**< Data */
 } i2c_msg;
 
 
-class WireBase {
+// Conditions a transfer is retried on (see WireBaseT::setRetryPolicy)
+#define I2C_RETRY_NACK_ADDR     0x01
+#define I2C_RETRY_NACK_DATA     0x02
+#define I2C_RETRY_ERROR         0x04    /**< bus error / arbitration loss */
+#define I2C_RETRY_TIMEOUT       0x08
+#define I2C_RETRY_ALL           0x0F
+
+/**
+ * @brief Delay between retries
+ */
+enum I2CBackoff {
+    I2C_BACKOFF_NONE,           /**< retry immediately */
+    I2C_BACKOFF_FIXED,          /**< wait delay_us before each retry */
+    I2C_BACKOFF_EXPONENTIAL     /**< wait delay_us, doubled on each retry */
+};
+
+/**
+ * @brief Retry policy of endTransmission() and requestFrom()
+ */
+typedef struct i2c_retry_policy {
+    uint8_t     retries;            /**< Retries after the first attempt (0 = off) */
+    uint8_t     conditions;         /**< Bitwise OR of I2C_RETRY_xxx */
+    I2CBackoff  backoff;            /**< Delay between retries */
+    uint16_t    delay_us;           /**< Base delay */
+} i2c_retry_policy;
+
+/**
+ * @brief Statically dispatched base of the Wire interface (CRTP).
+ *        Derived classes have to provide a process() function, which is
+ *        called without virtual dispatch. Only the Wire interface itself is
+ *        inlined into the caller; process() stays a plain call into the
+ *        derived class' translation unit.
+ *        WireBase is the polymorphic adaptor on top of it.
+ *        The received bytes are kept in a ring (rx_head/rx_tail, replacing
+ *        rx_buf_idx/rx_buf_len). process() gets a linear span of it, unless
+ *        the derived class sets rx_ring and handles spans wrapping at the
+ *        end of rx_buf (flagged with I2C_MSG_RING).
+ */
+template <class Derived>
+class WireBaseT {
 protected:
     i2c_msg itc_msg;
-    uint8_t rx_buf[I2C_TXRX_BUFFER_SIZE];   /* receive buffer */
-    uint8_t rx_buf_idx;                     /* first unread idx in rx_buf */
-    uint8_t rx_buf_len;                     /* number of bytes read */
+    uint8_t rx_buf[I2C_TXRX_BUFFER_SIZE];   /* receive ring buffer */
+    uint8_t rx_head;                        /* free running write count */
+    uint8_t rx_tail;                        /* free running read count */
+    bool rx_ring;                           /* process() handles I2C_MSG_RING */
 
     uint8_t tx_buf[I2C_TXRX_BUFFER_SIZE];   /* transmit buffer */
     uint8_t tx_buf_idx;                     // next idx available in tx_buf, -1 overflow
     bool tx_buf_overflow;
 
-    // Force derived classes to define process function
-    virtual uint8_t process() = 0;
+    i2c_retry_policy retry_policy;
+
+    Derived &derived() { return *static_cast<Derived*>(this); }
+
+    /*
+     * Calls process_fn, retrying according to the retry policy. The
+     * message and its buffer are left untouched between the attempts.
+     */
+    template <class F>
+    uint8_t retry(F process_fn);
+
+    /*
+     * Bodies of endTransmission() / requestFrom(), with the call to the
+     * process function supplied by the caller (i.e. with or without stop)
+     */
+    template <class F>
+    uint8_t transmit(F process_fn);
+    template <class F>
+    uint8_t request(uint8_t address, int num_bytes, F process_fn);
 public:
-    WireBase() {}
-    ~WireBase() {}
+    WireBaseT() : rx_ring(false), retry_policy({ 0, I2C_RETRY_ALL, I2C_BACKOFF_NONE, 0 }) {}
+    ~WireBaseT() {}
+
+    /*
+     * Sets the retry policy, i.e. setRetryPolicy(3, I2C_RETRY_ALL,
+     * I2C_BACKOFF_EXPONENTIAL, 100) retries up to 3 times after waiting
+     * 100, 200 and 400 us.
+     */
+    void setRetryPolicy(uint8_t retries, uint8_t conditions = I2C_RETRY_ALL,
+                        I2CBackoff backoff = I2C_BACKOFF_NONE, uint16_t delay_us = 0);
 
     /*
      * Initialises the class interface
      */
-    // Allow derived classes to overwrite begin function
-    virtual void begin(uint8_t = 0x00);
+    void begin(uint8_t = 0x00);
 
     /*
      * Sets up the transmission message to be processed
@@ -148,14 +222,261 @@ public:
      */
     void write(char*);
 
+    /*
+     * Stack up bytes from the array to be sent when transmitting, copying
+     * them in one go. Returns the number of bytes stacked up.
+     */
+    size_t writeBytes(const uint8_t*, size_t);
+
     /*
      * Return the amount of bytes that is currently in the receiving buffer
      */
     uint8_t available();
 
+    /*
+     * Copy up to the given number of bytes out of the receiving buffer.
+     * Returns the number of bytes copied.
+     */
+    size_t readBytes(uint8_t*, size_t);
+
+    /*
+     * Return the next byte in the receiving buffer without consuming it,
+     * -1 if there's none
+     */
+    int peek();
+
     /*
      * Return the value of byte in the receiving buffer that is currently being
      * pointed to
      */
     uint8_t read();
 };
+
+/**
+ * @brief Polymorphic Wire interface, for code handling software and
+ *        hardware I2C through the same base class.
+ */
+class WireBase : public WireBaseT<WireBase> {
+    friend class WireBaseT<WireBase>;
+protected:
+    // Force derived classes to define process function
+    virtual uint8_t process() = 0;
+public:
+    WireBase() {}
+    ~WireBase() {}
+
+    /*
+     * Initialises the class interface
+     */
+    // Allow derived classes to overwrite begin function
+    virtual void begin(uint8_t = 0x00);
+};
+
+template <class Derived>
+void WireBaseT<Derived>::begin(uint8_t self_addr) {
+    UNUSED(self_addr);
+    tx_buf_idx = 0;
+    tx_buf_overflow = false;
+    rx_head = 0;
+    rx_tail = 0;
+}
+
+template <class Derived>
+void WireBaseT<Derived>::setRetryPolicy(uint8_t retries, uint8_t conditions, I2CBackoff backoff, uint16_t delay_us) {
+    retry_policy.retries = retries;
+    retry_policy.conditions = conditions;
+    retry_policy.backoff = backoff;
+    retry_policy.delay_us = delay_us;
+}
+
+template <class Derived>
+template <class F>
+uint8_t WireBaseT<Derived>::retry(F process_fn) {
+    for (uint8_t attempt = 0; ; attempt++) {
+        uint8_t stat = process_fn();
+        if (stat == I2C_OK || attempt >= retry_policy.retries) {
+            return stat;
+        }
+        uint8_t condition;
+        switch (stat) {
+            case I2C_NACK_ADDR: condition = I2C_RETRY_NACK_ADDR; break;
+            case I2C_NACK_DATA: condition = I2C_RETRY_NACK_DATA; break;
+            case I2C_TIMEOUT:   condition = I2C_RETRY_TIMEOUT; break;
+            case I2C_ERROR:     condition = I2C_RETRY_ERROR; break;
+            default:            return stat;
+        }
+        if (!(retry_policy.conditions & condition)) {
+            return stat;
+        }
+        if (retry_policy.backoff == I2C_BACKOFF_FIXED) {
+            delayMicroseconds(retry_policy.delay_us);
+        } else if (retry_policy.backoff == I2C_BACKOFF_EXPONENTIAL) {
+            delayMicroseconds((uint32_t)retry_policy.delay_us << (attempt < 16 ? attempt : 16));
+        }
+    }
+}
+
+template <class Derived>
+void WireBaseT<Derived>::beginTransmission(uint8_t slave_address) {
+    itc_msg.addr = slave_address;
+    itc_msg.data = &tx_buf[tx_buf_idx];
+    itc_msg.length = 0;
+    itc_msg.flags = 0;
+}
+
+template <class Derived>
+void WireBaseT<Derived>::beginTransmission(int slave_address) {
+    beginTransmission((uint8_t)slave_address);
+}
+
+template <class Derived>
+uint8_t WireBaseT<Derived>::endTransmission(void) {
+    return transmit([this]() { return derived().process(); });
+}
+
+template <class Derived>
+template <class F>
+uint8_t WireBaseT<Derived>::transmit(F process_fn) {
+    if (tx_buf_overflow) {
+        return I2C_DATA_TOO_LONG;
+    }
+    uint8_t stat = retry(process_fn); // added 2022-06-05 Technik Gegg
+    tx_buf_idx = 0;
+    tx_buf_overflow = false;
+    return stat; 	// added 2022-06-05 Technik Gegg
+					// returning I2C_OK doesn't reflect the current status (i.e. I2C_NACK_ADDR)
+					// and hence a bus scan will always deliver a found device at the
+					// given address!
+}
+
+//TODO: Add the ability to queue messages (adding a bool to end of function
+// call, allows for the Arduino style to stay while also giving the flexibility
+// to bulk send
+template <class Derived>
+uint8_t WireBaseT<Derived>::requestFrom(uint8_t address, int num_bytes) {
+    return request(address, num_bytes, [this]() { return derived().process(); });
+}
+
+template <class Derived>
+template <class F>
+uint8_t WireBaseT<Derived>::request(uint8_t address, int num_bytes, F process_fn) {
+    // unread bytes stay in the ring, the new ones are appended behind them
+    if (rx_head == rx_tail) {
+        rx_head = 0;
+        rx_tail = 0;
+    }
+    int room = I2C_TXRX_BUFFER_SIZE - available();
+    if (!rx_ring) {
+        // process() stores linearly, so the data mustn't wrap
+        int span = I2C_TXRX_BUFFER_SIZE - (rx_head & I2C_RX_MASK);
+        if (room > span) {
+            room = span;
+        }
+    }
+    if (num_bytes > room) {
+        num_bytes = room;
+    }
+    itc_msg.addr = address;
+    itc_msg.flags = rx_ring ? (I2C_MSG_READ | I2C_MSG_RING) : I2C_MSG_READ;
+    itc_msg.length = num_bytes;
+    itc_msg.data = &rx_buf[rx_head & I2C_RX_MASK];
+    retry(process_fn);
+    rx_head += itc_msg.xferred;
+    itc_msg.flags = 0;
+    return available();
+}
+
+template <class Derived>
+uint8_t WireBaseT<Derived>::requestFrom(int address, int numBytes) {
+    return requestFrom((uint8_t)address, numBytes);
+}
+
+template <class Derived>
+void WireBaseT<Derived>::write(uint8_t value) {
+    if (tx_buf_idx == I2C_TXRX_BUFFER_SIZE) {
+        tx_buf_overflow = true;
+        return;
+    }
+    tx_buf[tx_buf_idx++] = value;
+    itc_msg.length++;
+}
+
+template <class Derived>
+void WireBaseT<Derived>::write(uint8_t* buf, int len) {
+    if (len > 0) {
+        writeBytes(buf, len);
+    }
+}
+
+template <class Derived>
+size_t WireBaseT<Derived>::writeBytes(const uint8_t* buf, size_t len) {
+    size_t room = I2C_TXRX_BUFFER_SIZE - tx_buf_idx;
+    if (len > room) {
+        tx_buf_overflow = true;
+        len = room;
+    }
+    memcpy(&tx_buf[tx_buf_idx], buf, len);
+    tx_buf_idx += len;
+    itc_msg.length += len;
+    return len;
+}
+
+template <class Derived>
+void WireBaseT<Derived>::write(int value) {
+    write((uint8_t)value);
+}
+
+template <class Derived>
+void WireBaseT<Derived>::write(int* buf, int len) {
+    write((uint8_t*)buf, (uint8_t)len);
+}
+
+template <class Derived>
+void WireBaseT<Derived>::write(char* buf) {
+    uint8_t *ptr = (uint8_t*)buf;
+    while (*ptr) {
+        write(*ptr);
+        ptr++;
+    }
+}
+
+template <class Derived>
+uint8_t WireBaseT<Derived>::available() {
+    return (uint8_t)(rx_head - rx_tail);
+}
+
+template <class Derived>
+size_t WireBaseT<Derived>::readBytes(uint8_t* buf, size_t len) {
+    size_t avail = available();
+    if (len > avail) {
+        len = avail;
+    }
+    size_t pos = rx_tail & I2C_RX_MASK;
+    size_t first = I2C_TXRX_BUFFER_SIZE - pos;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(buf, &rx_buf[pos], first);
+    memcpy(buf + first, rx_buf, len - first);
+    rx_tail += len;
+    return len;
+}
+
+template <class Derived>
+int WireBaseT<Derived>::peek() {
+    if (rx_head == rx_tail) {
+        return -1;
+    }
+    return rx_buf[rx_tail & I2C_RX_MASK];
+}
+
+template <class Derived>
+uint8_t WireBaseT<Derived>::read() {
+    if (rx_head == rx_tail) {
+        return 0;
+    }
+    return rx_buf[rx_tail++ & I2C_RX_MASK];
+}
+
+// the polymorphic flavour is instantiated once in WireBase.cpp
+extern template class WireBaseT<WireBase>;
@@ -0,0 +1,194 @@
+/**
+ * @file sniffer.cpp
+ * @brief Host test of I2CSnifferDecoder.
+ */
+
+/*
+ * Feeds the decoder with edge streams of the transfers a master would
+ * produce (each line change is one sample, as if the bus was polled fast
+ * enough) and checks the records it decodes: a plain write, a write followed
+ * by a read with a repeated start, the read ending with a NACK on its last
+ * byte, an address nobody ACKs, and a ring buffer overflow.
+ *
+ * Prints one line per failed check. The exit code is 1 if any check failed.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "I2CSniffer.h"
+
+#define SNIFF_RECORDS   4
+
+static int failures = 0;
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);          \
+            failures++;                                                     \
+        }                                                                   \
+    } while (0)
+
+/*
+ * Edge stream of a master, the levels being the wired AND of all drivers
+ */
+class EdgeStream {
+private:
+    I2CSnifferDecoder &decoder;
+    bool sda;
+    bool scl;
+
+    void set(bool new_sda, bool new_scl)
+    {
+        sda = new_sda;
+        scl = new_scl;
+        decoder.feed(sda, scl);
+    }
+
+    void bit(bool value)
+    {
+        set(value, false);
+        set(value, true);
+        set(value, false);
+    }
+
+public:
+    EdgeStream(I2CSnifferDecoder &decoder) : decoder(decoder), sda(true), scl(true)
+    {
+        decoder.feed(sda, scl);
+    }
+
+    // Start or Repeated Start, leaving SCL low
+    void start()
+    {
+        if (!scl)
+        {
+            set(true, false);
+            set(true, true);
+        }
+        set(false, true);
+        set(false, false);
+    }
+
+    void stop()
+    {
+        set(false, false);
+        set(false, true);
+        set(true, true);
+    }
+
+    // eight data bits followed by the acknowledge bit (low for ACK)
+    void byte(uint8_t value, bool ack)
+    {
+        for (int8_t i = 7; i >= 0; i--)
+            bit((value >> i) & 1);
+        bit(!ack);
+    }
+
+    void address(uint8_t addr, bool read, bool ack)
+    {
+        byte((addr << 1) | (read ? 1 : 0), ack);
+    }
+};
+
+static void check_record(I2CSnifferDecoder &decoder, uint8_t addr, uint8_t flags, const uint8_t *data, uint8_t length)
+{
+    i2c_sniff_record record;
+    CHECK(decoder.read(record));
+    CHECK(record.addr == addr);
+    CHECK(record.flags == flags);
+    CHECK(record.length == length);
+    CHECK(memcmp(record.data, data, length) == 0);
+}
+
+static void test_write()
+{
+    i2c_sniff_record storage[SNIFF_RECORDS];
+    I2CSnifferDecoder decoder(storage, SNIFF_RECORDS);
+    EdgeStream bus(decoder);
+    const uint8_t data[] = { 0x01, 0xA5 };
+
+    bus.start();
+    bus.address(0x48, false, true);
+    bus.byte(data[0], true);
+    bus.byte(data[1], true);
+    bus.stop();
+
+    CHECK(decoder.available() == 1);
+    check_record(decoder, 0x48, 0, data, sizeof(data));
+    CHECK(decoder.available() == 0);
+}
+
+static void test_repeated_start_read()
+{
+    i2c_sniff_record storage[SNIFF_RECORDS];
+    I2CSnifferDecoder decoder(storage, SNIFF_RECORDS);
+    EdgeStream bus(decoder);
+    const uint8_t reg[] = { 0x10 };
+    const uint8_t data[] = { 0x11, 0x22, 0x33 };
+
+    // register address write, then read back with a repeated start; the
+    // master NACKs the last byte it wants
+    bus.start();
+    bus.address(0x50, false, true);
+    bus.byte(reg[0], true);
+    bus.start();
+    bus.address(0x50, true, true);
+    bus.byte(data[0], true);
+    bus.byte(data[1], true);
+    bus.byte(data[2], false);
+    bus.stop();
+
+    CHECK(decoder.available() == 2);
+    check_record(decoder, 0x50, I2C_SNIFF_RSTART, reg, sizeof(reg));
+    check_record(decoder, 0x50, I2C_SNIFF_READ | I2C_SNIFF_NACK, data, sizeof(data));
+    CHECK(decoder.decoded() == 2);
+}
+
+static void test_address_nack()
+{
+    i2c_sniff_record storage[SNIFF_RECORDS];
+    I2CSnifferDecoder decoder(storage, SNIFF_RECORDS);
+    EdgeStream bus(decoder);
+
+    bus.start();
+    bus.address(0x3C, false, false);
+    bus.stop();
+
+    CHECK(decoder.available() == 1);
+    check_record(decoder, 0x3C, I2C_SNIFF_NACK, nullptr, 0);
+}
+
+static void test_overflow()
+{
+    i2c_sniff_record storage[SNIFF_RECORDS];
+    I2CSnifferDecoder decoder(storage, SNIFF_RECORDS);
+    EdgeStream bus(decoder);
+
+    // one transfer more than the ring holds, the last one is dropped
+    for (uint8_t i = 0; i <= SNIFF_RECORDS; i++)
+    {
+        bus.start();
+        bus.address(0x20, false, true);
+        bus.byte(i, true);
+        bus.stop();
+    }
+
+    CHECK(decoder.available() == SNIFF_RECORDS);
+    CHECK(decoder.overflows() == 1);
+    CHECK(decoder.decoded() == SNIFF_RECORDS + 1);
+    for (uint8_t i = 0; i < SNIFF_RECORDS; i++)
+        check_record(decoder, 0x20, 0, &i, 1);
+    CHECK(!decoder.read(storage[0]));
+}
+
+int main()
+{
+    test_write();
+    test_repeated_start_read();
+    test_address_nack();
+    test_overflow();
+    if (failures == 0)
+        printf("PASS sniffer\n");
+    return failures ? 1 : 0;
+}
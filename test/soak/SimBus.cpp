@@ -0,0 +1,479 @@
+/**
+ * @file SimBus.cpp
+ * @brief Simulated I2C bus and the host implementation of the core
+ *        functions used by SoftWire.
+ */
+
+#include <stdio.h>
+#include "SimBus.h"
+
+SimBus sim;
+SimDWT sim_dwt;
+SimCoreDebug sim_core_debug;
+
+/*
+ * SimTarget
+ */
+
+SimTarget::SimTarget(uint8_t addr) : state(IDLE), bits(0), shift(0), reading(false), acked(false), sent(false), rx_count(0), falls(0),
+    sda_low(false), sda_hold_until(0), scl_hold_until(0), addr(addr), ptr(0), random(&sim.random)
+{
+    memset(mem, 0, sizeof(mem));
+    disarm();
+}
+
+void SimTarget::disarm()
+{
+    nackAddr = false;
+    nackData = -1;
+    stretchPerMille = 0;
+    stretchMaxUs = 0;
+    longStretchUs = 0;
+    holdSdaAt = -1;
+    holdSdaUs = 0;
+    fired = 0;
+}
+
+uint64_t SimTarget::releaseAt(uint64_t now) const
+{
+    uint64_t at = 0;
+    if (sda_hold_until > now)
+        at = sda_hold_until;
+    if (scl_hold_until > now && (at == 0 || scl_hold_until < at))
+        at = scl_hold_until;
+    return at;
+}
+
+void SimTarget::load_byte()
+{
+    shift = mem[ptr++];
+    bits = 0;
+    sda_low = !(shift & 0x80);
+}
+
+void SimTarget::stretch(uint64_t now, uint64_t cycles)
+{
+    if (scl_hold_until < now + cycles)
+        scl_hold_until = now + cycles;
+}
+
+void SimTarget::onStart()
+{
+    state = ADDR;
+    bits = 0;
+    shift = 0;
+    falls = 0;
+    sda_low = false;
+}
+
+void SimTarget::onStop()
+{
+    state = IDLE;
+    sda_low = false;
+}
+
+void SimTarget::onRise(bool sda)
+{
+    switch (state)
+    {
+        case ADDR:
+        case RX:
+            shift = (shift << 1) | sda;
+            bits++;
+            break;
+        case TX:
+            bits++;
+            sent = true;
+            break;
+        case TX_ACK:
+            acked = !sda;
+            break;
+        default:
+            break;
+    }
+}
+
+void SimTarget::onFall(uint64_t now)
+{
+    falls++;
+    if (holdSdaAt >= 0 && falls == (uint32_t)holdSdaAt)
+    {
+        // a stuck target, addressed or not
+        sda_hold_until = now + (uint64_t)holdSdaUs * SIM_CYCLES_PER_US;
+        holdSdaAt = -1;
+        fired |= SIM_FAULT_HOLD_SDA;
+    }
+
+    switch (state)
+    {
+        case ADDR:
+            if (bits < 8)
+                break;
+            if ((shift >> 1) != addr)
+            {
+                state = IGNORE;
+                break;
+            }
+            if (nackAddr)
+            {
+                nackAddr = false;
+                fired |= SIM_FAULT_NACK_ADDR;
+                state = IGNORE;
+                break;
+            }
+            reading = shift & 1;
+            sent = false;
+            rx_count = 0;
+            sda_low = true;
+            state = ADDR_ACK;
+            break;
+        case ADDR_ACK:
+            sda_low = false;
+            if (longStretchUs)
+            {
+                stretch(now, (uint64_t)longStretchUs * SIM_CYCLES_PER_US);
+                longStretchUs = 0;
+                fired |= SIM_FAULT_LONG_STRETCH;
+            }
+            if (reading)
+            {
+                load_byte();
+                state = TX;
+            }
+            else
+            {
+                bits = 0;
+                shift = 0;
+                state = RX;
+            }
+            break;
+        case RX:
+            if (bits < 8)
+                break;
+            if (nackData >= 0 && rx_count == (uint16_t)nackData)
+            {
+                nackData = -1;
+                fired |= SIM_FAULT_NACK_DATA;
+                state = IGNORE;
+                break;
+            }
+            if (rx_count == 0)
+                ptr = shift;
+            else
+                mem[ptr++] = shift;
+            rx_count++;
+            sda_low = true;
+            state = RX_ACK;
+            break;
+        case RX_ACK:
+            sda_low = false;
+            bits = 0;
+            shift = 0;
+            state = RX;
+            break;
+        case TX:
+            if (bits < 8)
+            {
+                sda_low = !((shift << bits) & 0x80);
+                break;
+            }
+            sda_low = false;
+            state = TX_ACK;
+            break;
+        case TX_ACK:
+            // the master NACKs the last byte it wants
+            if (acked)
+            {
+                load_byte();
+                state = TX;
+            }
+            else
+                state = IGNORE;
+            break;
+        default:
+            break;
+    }
+
+    if (state >= ADDR_ACK && state <= TX_ACK && stretchPerMille && random->chance(stretchPerMille))
+    {
+        stretch(now, (uint64_t)random->range(1, stretchMaxUs) * SIM_CYCLES_PER_US);
+        fired |= SIM_FAULT_STRETCH;
+    }
+}
+
+/*
+ * SimBus
+ */
+
+SimBus::SimBus() : sdaPin((PinName)SDA), sclPin((PinName)SCL)
+{
+    reset(1);
+}
+
+void SimBus::reset(uint32_t seed)
+{
+    target_cnt = 0;
+    master_sda = master_scl = true;
+    sda_line = scl_line = true;
+    scl_edge_at = 0;
+    in_transfer = false;
+    now = 0;
+    random.seed(seed);
+    jitterPerMille = 0;
+    jitterMaxUs = 0;
+    pinWrites = starts = stops = clocks = 0;
+    minHigh = minLow = UINT64_MAX;
+    startAt = readAt = 0;
+}
+
+void SimBus::attach(SimTarget &target)
+{
+    if (target_cnt < SIM_MAX_TARGETS)
+        targets[target_cnt++] = &target;
+}
+
+void SimBus::edge_timing(bool rising)
+{
+    if (in_transfer)
+    {
+        uint64_t len = now - scl_edge_at;
+        if (rising)
+        {
+            clocks++;
+            if (len < minLow)
+                minLow = len;
+        }
+        else if (len < minHigh)
+            minHigh = len;
+    }
+    scl_edge_at = now;
+}
+
+void SimBus::update()
+{
+    // the targets react to each edge, which may change the lines again
+    for (uint8_t guard = 0; guard < 8; guard++)
+    {
+        bool sda = master_sda, scl = master_scl;
+        for (uint8_t i = 0; i < target_cnt; i++)
+        {
+            if (targets[i]->pullsSda(now))
+                sda = false;
+            if (targets[i]->pullsScl(now))
+                scl = false;
+        }
+        if (scl != scl_line)
+        {
+            scl_line = scl;
+            sda_line = sda;
+            edge_timing(scl);
+            for (uint8_t i = 0; i < target_cnt; i++)
+            {
+                if (scl && targets[i]->firstBitNext())
+                    readAt = now;
+                if (scl)
+                    targets[i]->onRise(sda);
+                else
+                    targets[i]->onFall(now);
+            }
+            continue;
+        }
+        if (sda != sda_line)
+        {
+            sda_line = sda;
+            if (scl_line)
+            {
+                // SDA changing while SCL is high: Start or Stop condition
+                if (!sda)
+                    starts++;
+                else
+                    stops++;
+                if (!sda && !in_transfer)
+                {
+                    startAt = now;
+                    readAt = 0;
+                }
+                in_transfer = !sda;
+                for (uint8_t i = 0; i < target_cnt; i++)
+                {
+                    if (!sda)
+                        targets[i]->onStart();
+                    else
+                        targets[i]->onStop();
+                }
+            }
+            continue;
+        }
+        break;
+    }
+}
+
+void SimBus::advance(uint64_t cycles)
+{
+    now += cycles;
+    update();
+}
+
+void SimBus::write(PinName pin, bool level)
+{
+    if (jitterPerMille && random.chance(jitterPerMille))
+        now += (uint64_t)random.range(1, jitterMaxUs) * SIM_CYCLES_PER_US;
+    now += SIM_PIN_WRITE_CYCLES;
+    pinWrites++;
+    if (pin == sdaPin)
+        master_sda = level;
+    else if (pin == sclPin)
+        master_scl = level;
+    update();
+}
+
+bool SimBus::read(PinName pin)
+{
+    advance(SIM_PIN_READ_CYCLES);
+    if (pin == sdaPin)
+        return sda_line;
+    if (pin == sclPin)
+        return scl_line;
+    return HIGH;
+}
+
+void SimBus::settle(uint32_t maxUs)
+{
+    uint64_t end = now + (uint64_t)maxUs * SIM_CYCLES_PER_US;
+    while (now < end)
+    {
+        uint64_t next = 0;
+        for (uint8_t i = 0; i < target_cnt; i++)
+        {
+            uint64_t at = targets[i]->releaseAt(now);
+            if (at && (next == 0 || at < next))
+                next = at;
+        }
+        if (next == 0)
+            break;
+        advance((next < end ? next : end) - now);
+    }
+}
+
+bool SimBus::idle() const
+{
+    if (!sda_line || !scl_line)
+        return false;
+    for (uint8_t i = 0; i < target_cnt; i++)
+    {
+        if (!targets[i]->idle(now))
+            return false;
+    }
+    return true;
+}
+
+/*
+ * Core functions
+ */
+
+void pinMode(uint32_t pin, uint32_t mode)
+{
+    if (mode == INPUT || mode == INPUT_PULLUP)
+        sim.release((PinName)pin);
+}
+
+void digitalWriteFast(PinName pin, uint32_t value)
+{
+    sim.write(pin, value != LOW);
+}
+
+int digitalReadFast(PinName pin)
+{
+    return sim.read(pin) ? HIGH : LOW;
+}
+
+uint32_t millis()
+{
+    sim.advance(SIM_CALL_CYCLES);
+    return sim.millis();
+}
+
+uint32_t micros()
+{
+    sim.advance(SIM_CALL_CYCLES);
+    return sim.micros();
+}
+
+void delay(uint32_t ms)
+{
+    sim.advance((uint64_t)ms * (F_CPU / 1000U));
+}
+
+void delayMicroseconds(uint32_t us)
+{
+    sim.advanceUs(us);
+}
+
+void attachInterrupt(uint32_t pin, std::function<void(void)> callback, uint32_t mode)
+{
+    // data ready lines aren't simulated
+    UNUSED(pin);
+    UNUSED(callback);
+    UNUSED(mode);
+}
+
+void detachInterrupt(uint32_t pin)
+{
+    UNUSED(pin);
+}
+
+// replaces the weak delay loop of the library
+void I2C_Delay(uint16_t loops)
+{
+    sim.advance(SIM_CALL_CYCLES + (uint64_t)loops * SIM_LOOP_CYCLES);
+}
+
+SimGpioIDR::operator uint32_t() const
+{
+    uint32_t value = 0;
+    if (STM_PORT(sim.sdaPin) == port && sim.read(sim.sdaPin))
+        value |= STM_GPIO_PIN(sim.sdaPin);
+    if (STM_PORT(sim.sclPin) == port && sim.read(sim.sclPin))
+        value |= STM_GPIO_PIN(sim.sclPin);
+    return value;
+}
+
+SimGpioBSRR &SimGpioBSRR::operator=(uint32_t value)
+{
+    // set with the lower, reset with the upper half word
+    PinName pins[2] = { sim.sdaPin, sim.sclPin };
+    for (PinName pin : pins)
+    {
+        if (STM_PORT(pin) != port)
+            continue;
+        if (value & STM_GPIO_PIN(pin))
+            sim.write(pin, HIGH);
+        else if (value & ((uint32_t)STM_GPIO_PIN(pin) << 16))
+            sim.write(pin, LOW);
+    }
+    return *this;
+}
+
+GPIO_TypeDef *get_GPIO_Port(uint32_t port)
+{
+    static GPIO_TypeDef ports[8] = {
+        { { 0 }, { 0 } }, { { 1 }, { 1 } }, { { 2 }, { 2 } }, { { 3 }, { 3 } },
+        { { 4 }, { 4 } }, { { 5 }, { 5 } }, { { 6 }, { 6 } }, { { 7 }, { 7 } }
+    };
+    return (port < 8) ? &ports[port] : nullptr;
+}
+
+uint32_t sim_ipsr = 0;
+
+SimCycleCounter::operator uint32_t() const
+{
+    sim.advance(SIM_CLOCK_READ_CYCLES);
+    return (uint32_t)sim.now;
+}
+
+size_t Print::print(unsigned long value)
+{
+    char buf[12];
+    snprintf(buf, sizeof(buf), "%lu", value);
+    return write(buf);
+}
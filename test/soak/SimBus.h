@@ -0,0 +1,196 @@
+/**
+ * @file SimBus.h
+ * @brief Simulated open-drain I2C bus with register targets, used by the
+ *        host soak test.
+ */
+
+/*
+ * SDA and SCL are wired-AND lines: each is high unless the master or one of
+ * the targets pulls it low. Time is counted in CPU cycles and only advances
+ * when the library touches a pin, reads a clock or delays (see the costs
+ * below), so the library sees a bus running at a realistic speed and the
+ * runs are reproducible for a given seed.
+ * The targets are edge driven 256 byte register files: the first byte
+ * written after the address sets the register pointer, further bytes are
+ * written to it, reads start at it. Both auto-increment.
+ * Faults are armed by the harness on a target and fire at most once:
+ * address NACK, data NACK, clock stretching (short, or longer than the
+ * library's STRETCH_TIMEOUT) and holding SDA low for a while.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+// CPU cycles spent by the simulated core functions
+#define SIM_PIN_WRITE_CYCLES    12
+#define SIM_PIN_READ_CYCLES     6
+#define SIM_CLOCK_READ_CYCLES   2
+#define SIM_CALL_CYCLES         10
+#define SIM_LOOP_CYCLES         4
+
+#define SIM_CYCLES_PER_US       (F_CPU / 1000000U)
+
+#define SIM_MAX_TARGETS         8
+
+// faults (SimTarget::fired)
+#define SIM_FAULT_NACK_ADDR     0x01
+#define SIM_FAULT_NACK_DATA     0x02
+#define SIM_FAULT_STRETCH       0x04
+#define SIM_FAULT_LONG_STRETCH  0x08
+#define SIM_FAULT_HOLD_SDA      0x10
+// faults the bus protocol can't recover from within the transfer
+#define SIM_FAULT_DISRUPTIVE    (SIM_FAULT_LONG_STRETCH | SIM_FAULT_HOLD_SDA)
+
+/**
+ * @brief xorshift32, so the runs don't depend on the host's rand()
+ */
+class SimRandom {
+private:
+    uint32_t state;
+public:
+    SimRandom(uint32_t seed = 1) { this->seed(seed); }
+    void seed(uint32_t seed) { state = seed ? seed : 0x9E3779B9; }
+    uint32_t next()
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+    // uniform in [lo, hi]
+    uint32_t range(uint32_t lo, uint32_t hi) { return lo + next() % (hi - lo + 1); }
+    // true with a probability of perMille / 1000
+    bool chance(uint32_t perMille) { return next() % 1000 < perMille; }
+};
+
+/**
+ * @brief Register target on the simulated bus
+ */
+class SimTarget {
+private:
+    enum {
+        IDLE,           // waiting for a Start condition
+        ADDR,           // receiving the address
+        ADDR_ACK,       // acknowledging the address
+        RX,             // receiving data
+        RX_ACK,         // acknowledging a data byte
+        TX,             // sending data
+        TX_ACK,         // waiting for the master's ACK
+        IGNORE          // not addressed (or gave up), until the next condition
+    } state;
+    uint8_t bits;           // bits shifted in the current byte
+    uint8_t shift;
+    bool reading;           // addressed for a read
+    bool acked;             // the master ACKed the byte sent
+    bool sent;              // a bit has been sent since the address
+    uint16_t rx_count;      // bytes received since the address
+    uint32_t falls;         // falling SCL edges since the last Start
+    bool sda_low;           // protocol drive of SDA
+    uint64_t sda_hold_until;
+    uint64_t scl_hold_until;
+
+    void load_byte();
+    void stretch(uint64_t now, uint64_t cycles);
+
+public:
+    SimTarget(uint8_t addr);
+
+    const uint8_t addr;
+    uint8_t mem[256];
+    uint8_t ptr;            // register pointer
+
+    // faults, armed by the harness and disarmed when they fire
+    bool nackAddr;          // NACK the next address match
+    int16_t nackData;       // NACK the n-th byte received after the address, -1 = off
+    uint16_t stretchPerMille;   // chance to stretch each low phase of SCL while addressed
+    uint32_t stretchMaxUs;
+    uint32_t longStretchUs; // stretch once for this long after the address, 0 = off
+    int32_t holdSdaAt;      // hold SDA low from the n-th falling SCL edge after a Start, -1 = off
+    uint32_t holdSdaUs;
+    uint8_t fired;          // SIM_FAULT_xxx that fired since the last disarm()
+
+    SimRandom *random;
+
+    void disarm();
+
+    bool pullsSda(uint64_t now) const { return sda_low || sda_hold_until > now; }
+    bool pullsScl(uint64_t now) const { return scl_hold_until > now; }
+    // time at which a timed drive ends, 0 if there's none
+    uint64_t releaseAt(uint64_t now) const;
+    // the next rising SCL edge clocks the first bit sent since the address
+    bool firstBitNext() const { return state == TX && !sent; }
+    // waiting for a Start, with both lines released
+    bool idle(uint64_t now) const { return state == IDLE && !pullsSda(now) && !pullsScl(now); }
+
+    // bus events, dispatched by SimBus
+    void onStart();
+    void onStop();
+    void onRise(bool sda);
+    void onFall(uint64_t now);
+};
+
+/**
+ * @brief The simulated bus, driven by the master through the core functions
+ *        (digitalWriteFast(), the GPIO registers, ...)
+ */
+class SimBus {
+private:
+    SimTarget *targets[SIM_MAX_TARGETS];
+    uint8_t target_cnt;
+    bool master_sda;        // released by the master
+    bool master_scl;
+    bool sda_line;
+    bool scl_line;
+    uint64_t scl_edge_at;   // time of the last SCL edge
+    bool in_transfer;       // between Start and Stop
+
+    void update();
+    void edge_timing(bool rising);
+
+public:
+    SimBus();
+
+    PinName sdaPin;
+    PinName sclPin;
+    uint64_t now;           // simulated time in CPU cycles
+    SimRandom random;
+
+    // interrupts preempting the master: chance per pin write and length
+    uint16_t jitterPerMille;
+    uint32_t jitterMaxUs;
+
+    // observations
+    uint32_t pinWrites;
+    uint32_t starts;
+    uint32_t stops;
+    uint32_t clocks;        // rising SCL edges within transfers
+    uint64_t minHigh;       // shortest SCL high / low time within transfers (cycles)
+    uint64_t minLow;
+    uint64_t startAt;       // first Start condition of the last transfer
+    uint64_t readAt;        // rising SCL edge of the first bit a target sent after it, 0 if none
+
+    void reset(uint32_t seed);
+    void attach(SimTarget &target);
+
+    void advance(uint64_t cycles);
+    void advanceUs(uint32_t us) { advance((uint64_t)us * SIM_CYCLES_PER_US); }
+
+    void write(PinName pin, bool level);
+    bool read(PinName pin);
+    void release(PinName pin) { write(pin, HIGH); }
+
+    bool sda() const { return sda_line; }
+    bool scl() const { return scl_line; }
+    bool masterReleased() const { return master_sda && master_scl; }
+
+    // lets all timed drives of the targets run out (at most maxUs)
+    void settle(uint32_t maxUs);
+    // all targets wait for a Start and both lines are high
+    bool idle() const;
+
+    uint32_t millis() const { return now / (F_CPU / 1000U); }
+    uint32_t micros() const { return now / SIM_CYCLES_PER_US; }
+};
+
+extern SimBus sim;
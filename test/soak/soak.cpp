@@ -0,0 +1,919 @@
+/**
+ * @file soak.cpp
+ * @brief Randomised soak test of SoftWire against the simulated bus.
+ */
+
+/*
+ * Runs a long random sequence of writes, reads, repeated starts, scans and
+ * asynchronous transfers through the Wire interface (WireBase, or SoftWire
+ * itself with SOFTWIRE_STATIC_DISPATCH) and the SoftWire extensions, against
+ * register targets that randomly NACK, stretch SCL or hold SDA.
+ *
+ * Every result is checked against the targets: data read has to match their
+ * registers, data written has to end up in them, and a shadow copy of all
+ * registers catches writes going astray. A transfer hit by a NACK has to
+ * report it (unless the retry policy recovered), a clean one must succeed.
+ * Stretching past the timeout has to be reported as well. Data corrupted by
+ * a target holding SDA low can't be detected by the protocol and is only
+ * counted. With elastic timing, no SCL high or low phase may be shorter
+ * than the minimum of the speed mode. With SOFTWIRE_STATS, the refined cost
+ * model has to estimate a plain transfer on the delay loop within 20 %
+ * after the run. An open circuit breaker has to stay tripped when more
+ * devices fail than it has slots. The bus has to be released after each
+ * operation; if a confused target keeps SDA low, the harness clocks it free
+ * like an application would.
+ *
+ * The report is a single JSON object on stdout. The exit code is 1 if any
+ * of the checks failed.
+ *
+ * Usage: soak [--ops N] [--seed N] [--clock HZ] [--elastic] [--oversampling N]
+ *             [--retries N] [--faults PER_MILLE] [--jitter PER_MILLE]
+ *             [--variant NAME] [--verbose]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "SoftWire.h"
+#include "SimBus.h"
+
+#if defined(SOFTWIRE_STATIC_DISPATCH)
+typedef SoftWire WireApi;       // no polymorphic WireBase in this build
+#else
+typedef WireBase WireApi;
+#endif
+
+#define SOAK_TARGETS        4
+#define SOAK_ABSENT_ADDR    0x3C    // nobody answers here
+#define SOAK_MAX_LEN        64      // longest register access
+#define SOAK_SETTLE_US      (STRETCH_TIMEOUT * 2000U)
+#define SOAK_STAMP_CYCLES   32      // timestamp taken this close after its edge
+#define SOAK_BREAKER_ADDR   0x08    // first of the absent devices tripping the breaker
+
+static const uint8_t target_addrs[SOAK_TARGETS] = { 0x20, 0x48, 0x50, 0x68 };
+
+enum SoakOp {
+    OP_WIRE_WRITE,          // beginTransmission/write/endTransmission
+    OP_WIRE_READ,           // endTransmission(false) + requestFrom, possibly split
+    OP_READ_REGISTER,
+    OP_WRITE_REGISTER,
+    OP_TRANSFER,            // write + repeated start + read, or a single write
+    OP_UPDATE_BITS,
+    OP_ASYNC,               // startAsync/step, reads keep the bus with a repeated start
+    OP_SCAN,                // 16 addresses through the Wire interface
+    OP_COUNT
+};
+
+static const char *op_names[OP_COUNT] = {
+    "wire_write", "wire_read", "read_register", "write_register",
+    "transfer", "update_bits", "async", "scan"
+};
+
+static const char *status_names[] = {
+    "ok", "data_too_long", "nack_addr", "nack_data", "error", "timeout", "busy"
+};
+
+static const char *fault_names[] = {
+    "nack_addr", "nack_data", "stretch", "long_stretch", "hold_sda"
+};
+
+typedef struct soak_options {
+    uint32_t    ops;
+    uint32_t    seed;
+    uint32_t    clock;
+    bool        elastic;
+    uint8_t     oversampling;
+    uint8_t     retries;
+    uint16_t    faults;         // per mille of the operations
+    uint16_t    jitter;         // per mille of the pin writes
+    bool        verbose;        // failed checks to stderr
+    const char  *variant;
+} soak_options;
+
+/**
+ * @brief Outcome of a single operation
+ */
+typedef struct soak_result {
+    uint8_t     status;
+    bool        data_ok;        // read data / registers as expected (if status is I2C_OK)
+    bool        retried;        // goes through the retry policy of the Wire interface
+    bool        absent;         // addressed nobody
+    bool        nacks_expected; // the operation accounts for NACKs itself (scan)
+    bool        silent;         // the API can't report a timeout (requestFrom, scan)
+    uint16_t    bytes;          // payload transferred
+    int8_t      target;
+    // registers written, applied to the shadow on success
+    uint8_t     reg;
+    uint8_t     data[SOAK_MAX_LEN];
+    uint16_t    length;
+} soak_result;
+
+/*
+ * Minimum SCL low and high times of the speed mode of hz
+ */
+static void spec_minimums(uint32_t hz, uint32_t &low_ns, uint32_t &high_ns)
+{
+    if (hz <= 100000)
+    {
+        low_ns = I2C_SM_LOW_NS;
+        high_ns = I2C_SM_HIGH_NS;
+    }
+    else if (hz <= 400000)
+    {
+        low_ns = I2C_FM_LOW_NS;
+        high_ns = I2C_FM_HIGH_NS;
+    }
+    else
+    {
+        low_ns = I2C_FMP_LOW_NS;
+        high_ns = I2C_FMP_HIGH_NS;
+    }
+}
+
+class StdoutPrint : public Print {
+public:
+    size_t write(uint8_t value) { return fputc(value, stdout) != EOF; }
+};
+
+class Soak {
+private:
+    SoftWire &bus;
+    WireApi &wire;
+    SimTarget *targets[SOAK_TARGETS];
+    uint8_t shadow[SOAK_TARGETS][256];
+    SimRandom rnd;
+    const soak_options &opt;
+    uint32_t low_ns, high_ns;   // minimum SCL low / high time of the speed mode
+
+    // report
+    uint32_t op_counts[OP_COUNT];
+    uint32_t status_counts[I2C_BUSY + 1];
+    uint32_t fault_counts[5];
+    uint32_t ok, failed;
+    uint64_t bytes;
+    uint32_t bus_clears;
+    uint32_t undetected;
+    uint32_t v_integrity, v_spurious, v_missed, v_wrong_status, v_busy, v_released, v_shadow, v_stuck, v_timing, v_estimate, v_stamps, v_breaker;
+    uint32_t estimate_us, actual_us;
+    bool failing;
+    uint64_t fail_since;
+    uint32_t recoveries;
+    uint64_t recovery_sum, recovery_max;
+
+    uint8_t pick_target(soak_result &res);
+    void arm_faults(int8_t target, uint16_t max_written);
+    bool check_read(const soak_result &res, uint8_t reg, const uint8_t *buf, uint16_t len);
+    bool check_written(const soak_result &res);
+    void expect_busy(uint8_t stat, uint32_t writes);
+    void run_async();
+    void bus_clear();
+    void resync(int8_t target);
+    void check_estimate();
+    void check_stamps();
+    void check_breaker();
+
+    void op_wire_write(soak_result &res);
+    void op_wire_read(soak_result &res);
+    void op_read_register(soak_result &res);
+    void op_write_register(soak_result &res);
+    void op_transfer(soak_result &res);
+    void op_update_bits(soak_result &res);
+    void op_async(soak_result &res);
+    void op_scan(soak_result &res);
+
+    void evaluate(SoakOp op, const soak_result &res, uint64_t started);
+    void note(uint32_t &counter, const char *what, SoakOp op, const soak_result &res, uint8_t fired);
+
+public:
+    Soak(SoftWire &bus, WireApi &wire, SimTarget **targets, const soak_options &opt);
+
+    void run();
+    bool passed() const;
+    void report(double wall_ms);
+};
+
+Soak::Soak(SoftWire &bus, WireApi &wire, SimTarget **targets, const soak_options &opt) :
+    bus(bus), wire(wire), rnd(opt.seed * 2 + 1), opt(opt)
+{
+    spec_minimums(opt.clock, low_ns, high_ns);
+    memset(op_counts, 0, sizeof(op_counts));
+    memset(status_counts, 0, sizeof(status_counts));
+    memset(fault_counts, 0, sizeof(fault_counts));
+    ok = failed = 0;
+    bytes = 0;
+    bus_clears = undetected = 0;
+    v_integrity = v_spurious = v_missed = v_wrong_status = v_busy = v_released = v_shadow = v_stuck = v_timing = v_estimate = v_stamps = v_breaker = 0;
+    estimate_us = actual_us = 0;
+    failing = false;
+    fail_since = 0;
+    recoveries = 0;
+    recovery_sum = recovery_max = 0;
+    for (uint8_t i = 0; i < SOAK_TARGETS; i++)
+    {
+        this->targets[i] = targets[i];
+        for (uint16_t r = 0; r < 256; r++)
+            targets[i]->mem[r] = rnd.next();
+        resync(i);
+    }
+}
+
+uint8_t Soak::pick_target(soak_result &res)
+{
+    if (rnd.chance(30))
+    {
+        res.absent = true;
+        res.target = -1;
+        return SOAK_ABSENT_ADDR;
+    }
+    res.target = rnd.range(0, SOAK_TARGETS - 1);
+    return target_addrs[res.target];
+}
+
+void Soak::arm_faults(int8_t target, uint16_t max_written)
+{
+    if (!rnd.chance(opt.faults))
+        return;
+    if (target < 0)
+        target = rnd.range(0, SOAK_TARGETS - 1);
+    SimTarget &t = *targets[target];
+    uint32_t kind = rnd.range(0, 99);
+    if (kind < 55 && max_written && kind >= 30)
+        t.nackData = rnd.range(0, max_written - 1);
+    else if (kind < 55)
+        t.nackAddr = true;
+    else if (kind < 85)
+    {
+        t.stretchPerMille = 100;
+        t.stretchMaxUs = 50;
+    }
+    else if (kind < 87)
+        t.longStretchUs = STRETCH_TIMEOUT * 1000U + 100000U;
+    else
+    {
+        // any target may get stuck, not only the addressed one
+        SimTarget &s = *targets[rnd.range(0, SOAK_TARGETS - 1)];
+        s.holdSdaAt = rnd.range(1, 60);
+        s.holdSdaUs = rnd.range(5, 500);
+    }
+}
+
+bool Soak::check_read(const soak_result &res, uint8_t reg, const uint8_t *buf, uint16_t len)
+{
+    if (res.target < 0)
+        return false;
+    for (uint16_t i = 0; i < len; i++)
+    {
+        if (buf[i] != targets[res.target]->mem[(uint8_t)(reg + i)])
+            return false;
+    }
+    return true;
+}
+
+bool Soak::check_written(const soak_result &res)
+{
+    return check_read(res, res.reg, res.data, res.length);
+}
+
+void Soak::expect_busy(uint8_t stat, uint32_t writes)
+{
+    // rejected without touching the bus
+    if (stat != I2C_BUSY || sim.pinWrites != writes)
+        v_busy++;
+}
+
+void Soak::run_async()
+{
+    while (bus.asyncBusy())
+    {
+        // one phase per call, like a timer interrupt slow enough for the
+        // minimum times of the speed mode (a low or high phase takes two
+        // calls, the conditions one)
+        bus.step();
+        sim.advance(((uint64_t)low_ns * F_CPU + 999999999U) / 1000000000U);
+    }
+}
+
+void Soak::resync(int8_t target)
+{
+    for (uint8_t i = 0; i < SOAK_TARGETS; i++)
+    {
+        if (target < 0 || i == target)
+            memcpy(shadow[i], targets[i]->mem, 256);
+    }
+}
+
+void Soak::bus_clear()
+{
+    // up to nine clocks until the target lets go of SDA, then a Start and
+    // a Stop condition to reset all targets
+    bus_clears++;
+    for (uint8_t i = 0; i < 9 && !sim.sda(); i++)
+    {
+        digitalWriteFast(sim.sclPin, LOW);
+        delayMicroseconds(5);
+        digitalWriteFast(sim.sclPin, HIGH);
+        delayMicroseconds(5);
+    }
+    digitalWriteFast(sim.sdaPin, LOW);
+    delayMicroseconds(5);
+    digitalWriteFast(sim.sdaPin, HIGH);
+    delayMicroseconds(5);
+}
+
+void Soak::check_stamps()
+{
+#if defined(SOFTWIRE_TIMESTAMPS)
+    // taken right after the Start condition and the rising SCL edge of the
+    // first bit the target sent; the stamps are 32 bit cycle counts
+    for (uint8_t i = 0; i < SOAK_TARGETS; i++)
+    {
+        // a stuck SDA makes up conditions of its own
+        if (targets[i]->fired & SIM_FAULT_DISRUPTIVE)
+            return;
+    }
+    const i2c_timestamps &stamps = bus.getTimestamps();
+    if ((uint32_t)(stamps.start - (uint32_t)sim.startAt) > SOAK_STAMP_CYCLES ||
+        (uint32_t)(stamps.firstBit - (uint32_t)sim.readAt) > SOAK_STAMP_CYCLES)
+        v_stamps++;
+#endif
+}
+
+void Soak::check_breaker()
+{
+    // one failing device more than there are slots: it mustn't take the
+    // slot of a device whose breaker is still open
+    bus.setCircuitBreaker(1, 1000);
+    uint8_t data;
+    for (uint8_t i = 0; i <= SOFTWIRE_BREAKER_SLOTS; i++)
+        bus.readRegister(SOAK_BREAKER_ADDR + i, 0, &data, 1);
+    for (uint8_t i = 0; i < SOFTWIRE_BREAKER_SLOTS; i++)
+    {
+        if (!bus.isTripped(SOAK_BREAKER_ADDR + i))
+            v_breaker++;
+    }
+    bus.setCircuitBreaker(0);
+}
+
+void Soak::check_estimate()
+{
+    // the cost model of the delay loop is refined from clean transfers
+    // only; elastic ones, stretching and a bus held between calls must
+    // not have skewed it
+    bus.setElasticTiming(false);
+    sim.jitterPerMille = 0;
+    for (uint8_t i = 0; i < SOAK_TARGETS; i++)
+        targets[i]->disarm();
+    uint8_t data[8] = { 0 };
+    i2c_msg msg = { target_addrs[0], 0, sizeof(data), 0, data };
+    // a few transfers for the running average to settle, not enough to
+    // wash out a skewed one
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        uint64_t t = sim.now;
+        if (bus.transfer(&msg, 1) != I2C_OK)
+            break;
+        actual_us = (sim.now - t) / SIM_CYCLES_PER_US;
+        sim.advanceUs(50);
+    }
+    resync(0);
+    estimate_us = bus.estimateDuration(msg);
+    if (estimate_us * 10 < actual_us * 8 || estimate_us * 10 > actual_us * 12)
+        v_estimate++;
+}
+
+void Soak::op_wire_write(soak_result &res)
+{
+    uint8_t addr = pick_target(res);
+    res.reg = rnd.next();
+    res.length = rnd.range(1, I2C_TXRX_BUFFER_SIZE - 1);
+    for (uint16_t i = 0; i < res.length; i++)
+        res.data[i] = rnd.next();
+    res.retried = opt.retries > 0;
+    arm_faults(res.target, res.length + 1);
+
+    wire.beginTransmission(addr);
+    wire.write(res.reg);
+    wire.write(res.data, res.length);
+    res.status = wire.endTransmission();
+    res.data_ok = check_written(res);
+    res.bytes = res.length;
+}
+
+void Soak::op_wire_read(soak_result &res)
+{
+    uint8_t addr = pick_target(res);
+    uint8_t reg = rnd.next();
+    uint8_t len = rnd.range(1, I2C_TXRX_BUFFER_SIZE);
+    res.retried = opt.retries > 0;
+    res.silent = true;
+    arm_faults(res.target, 1);
+
+    wire.beginTransmission(addr);
+    wire.write(reg);
+    res.status = bus.endTransmission(false);
+    if (res.status != I2C_OK)
+        return;
+    if (rnd.chance(250))
+    {
+        // the bus is held for the repeated start
+        i2c_msg msg = { addr, 0, 1, 0, &reg };
+        uint32_t writes = sim.pinWrites;
+        expect_busy(bus.startAsync(&msg), writes);
+    }
+    else if (rnd.chance(250))
+    {
+        // an interrupt handler (EXTI0) can't continue it either
+        uint8_t value;
+        uint32_t writes = sim.pinWrites;
+        sim_ipsr = 22;
+        expect_busy(bus.readRegister(addr, reg, &value, 1), writes);
+        sim_ipsr = 0;
+    }
+    // sometimes in two parts, the second one appended to the unread first
+    uint8_t first = len;
+    if (len > 1 && rnd.chance(300))
+        first = rnd.range(1, len - 1);
+    uint8_t avail = wire.requestFrom(addr, (int)first);
+    if (avail == first && first < len)
+        avail = wire.requestFrom(addr, (int)(len - first));
+    // requestFrom() only tells how much arrived
+    res.status = (avail == len) ? I2C_OK : I2C_NACK_ADDR;
+    uint8_t buf[I2C_TXRX_BUFFER_SIZE];
+    uint8_t n = 0;
+    while (wire.available())
+        buf[n++] = wire.read();
+    res.data_ok = (n == avail) && check_read(res, reg, buf, n);
+    res.bytes = n;
+}
+
+void Soak::op_read_register(soak_result &res)
+{
+    uint8_t addr = pick_target(res);
+    uint8_t reg = rnd.next();
+    uint16_t len = rnd.range(1, SOAK_MAX_LEN);
+    uint8_t buf[SOAK_MAX_LEN];
+    arm_faults(res.target, 1);
+
+    res.status = bus.readRegister(addr, reg, buf, len);
+    res.data_ok = check_read(res, reg, buf, len);
+    if (res.status == I2C_OK)
+        check_stamps();
+    res.bytes = len;
+}
+
+void Soak::op_write_register(soak_result &res)
+{
+    uint8_t addr = pick_target(res);
+    res.reg = rnd.next();
+    res.length = rnd.range(1, SOAK_MAX_LEN);
+    for (uint16_t i = 0; i < res.length; i++)
+        res.data[i] = rnd.next();
+    arm_faults(res.target, res.length + 1);
+
+    res.status = bus.writeRegister(addr, res.reg, res.data, res.length);
+    res.data_ok = check_written(res);
+    res.bytes = res.length;
+}
+
+void Soak::op_transfer(soak_result &res)
+{
+    uint8_t addr = pick_target(res);
+    if (rnd.chance(300))
+    {
+        // a single write message: register and data
+        uint8_t buf[SOAK_MAX_LEN + 1];
+        res.reg = buf[0] = rnd.next();
+        res.length = rnd.range(1, SOAK_MAX_LEN);
+        for (uint16_t i = 0; i < res.length; i++)
+            res.data[i] = buf[i + 1] = rnd.next();
+        arm_faults(res.target, res.length + 1);
+        i2c_msg msg = { addr, 0, (uint16_t)(res.length + 1), 0, buf };
+        res.status = bus.transfer(&msg, 1);
+        res.data_ok = check_written(res);
+        res.bytes = res.length;
+        return;
+    }
+    uint8_t reg = rnd.next();
+    uint8_t buf[SOAK_MAX_LEN];
+    uint16_t len = rnd.range(1, SOAK_MAX_LEN);
+    arm_faults(res.target, 1);
+    i2c_msg msgs[2] = {
+        { addr, 0, 1, 0, &reg },
+        { addr, I2C_MSG_READ, len, 0, buf }
+    };
+    res.status = bus.transfer(msgs, 2);
+    res.data_ok = check_read(res, reg, buf, len) && msgs[1].xferred == len;
+    res.bytes = len;
+}
+
+void Soak::op_update_bits(soak_result &res)
+{
+    uint8_t addr = pick_target(res);
+    uint8_t mask = rnd.next();
+    uint8_t value = rnd.next();
+    res.reg = rnd.next();
+    res.length = 1;
+    if (res.target >= 0)
+    {
+        uint8_t old = targets[res.target]->mem[res.reg];
+        res.data[0] = (old & ~mask) | (value & mask);
+    }
+    arm_faults(res.target, 2);
+
+    res.status = bus.updateBits(addr, res.reg, mask, value);
+    res.data_ok = check_written(res);
+    res.bytes = 2;
+}
+
+void Soak::op_async(soak_result &res)
+{
+    uint8_t addr = pick_target(res);
+    if (rnd.chance(500))
+    {
+        uint8_t buf[SOAK_MAX_LEN + 1];
+        res.reg = buf[0] = rnd.next();
+        res.length = rnd.range(1, SOAK_MAX_LEN);
+        for (uint16_t i = 0; i < res.length; i++)
+            res.data[i] = buf[i + 1] = rnd.next();
+        arm_faults(res.target, res.length + 1);
+        i2c_msg msg = { addr, 0, (uint16_t)(res.length + 1), 0, buf };
+        res.status = bus.startAsync(&msg);
+        run_async();
+        if (res.status == I2C_OK)
+            res.status = bus.asyncStatus();
+        res.data_ok = check_written(res);
+        res.bytes = res.length;
+        return;
+    }
+    uint8_t reg = rnd.next();
+    uint8_t buf[SOAK_MAX_LEN];
+    uint16_t len = rnd.range(1, SOAK_MAX_LEN);
+    arm_faults(res.target, 1);
+    i2c_msg msgs[2] = {
+        { addr, 0, 1, 0, &reg },
+        { addr, I2C_MSG_READ, len, 0, buf }
+    };
+    res.status = bus.startAsync(&msgs[0], false);
+    run_async();
+    if (res.status == I2C_OK)
+        res.status = bus.asyncStatus();
+    if (res.status == I2C_OK)
+    {
+        // the engine holds the bus after the repeated start
+        uint8_t value;
+        uint32_t writes = sim.pinWrites;
+        expect_busy(bus.readRegister(addr, reg, &value, 1), writes);
+        res.status = bus.startAsync(&msgs[1]);
+        run_async();
+        if (res.status == I2C_OK)
+            res.status = bus.asyncStatus();
+        if (res.status == I2C_OK)
+            check_stamps();
+    }
+    res.data_ok = check_read(res, reg, buf, len) && msgs[1].xferred == len;
+    res.bytes = len;
+}
+
+void Soak::op_scan(soak_result &res)
+{
+    // a window of 16 addresses around one of the targets
+    res.target = rnd.range(0, SOAK_TARGETS - 1);
+    int16_t first = target_addrs[res.target] - (int16_t)rnd.range(0, 15);
+    if (first < 0x08)
+        first = 0x08;
+    res.retried = opt.retries > 0;
+    res.nacks_expected = true;
+    res.silent = true;
+    arm_faults(res.target, 0);
+
+    res.status = I2C_OK;
+    res.data_ok = true;
+    for (uint8_t addr = first; addr < first + 16 && addr < 0x78; addr++)
+    {
+        int8_t present = -1;
+        for (uint8_t i = 0; i < SOAK_TARGETS; i++)
+        {
+            if (target_addrs[i] == addr)
+                present = i;
+        }
+        wire.beginTransmission(addr);
+        bool found = (wire.endTransmission() == I2C_OK);
+        // a NACK fault hides the target, unless a retry finds it
+        bool expected = present >= 0 &&
+            (res.retried || !(targets[present]->fired & SIM_FAULT_NACK_ADDR));
+        if (found != expected)
+            res.data_ok = false;
+    }
+}
+
+void Soak::note(uint32_t &counter, const char *what, SoakOp op, const soak_result &res, uint8_t fired)
+{
+    counter++;
+    if (opt.verbose)
+        fprintf(stderr, "%s: %s target %d status %s data %s faults 0x%02x at %.6f s\n", what, op_names[op],
+                res.target, res.status <= I2C_BUSY ? status_names[res.status] : "?", res.data_ok ? "ok" : "bad",
+                fired, (double)sim.now / F_CPU);
+}
+
+void Soak::evaluate(SoakOp op, const soak_result &res, uint64_t started)
+{
+    uint8_t fired = 0;
+    for (uint8_t i = 0; i < SOAK_TARGETS; i++)
+        fired |= targets[i]->fired;
+    for (uint8_t k = 0; k < 5; k++)
+    {
+        if (fired & (1 << k))
+            fault_counts[k]++;
+    }
+    if (res.status <= I2C_BUSY)
+        status_counts[res.status]++;
+
+    bool clean = false;
+    if (fired & SIM_FAULT_DISRUPTIVE)
+    {
+        // a stretching timeout has to be reported, corrupted data on a
+        // held SDA can't be detected reliably and is only counted
+        if ((fired & SIM_FAULT_LONG_STRETCH) && !res.retried && !res.silent && res.status != I2C_TIMEOUT)
+            note(res.status == I2C_OK ? v_missed : v_wrong_status, "missed timeout", op, res, fired);
+        else if (res.status == I2C_OK && !res.data_ok)
+            note(undetected, "undetected", op, res, fired);
+        resync(-1);
+    }
+    else if (res.absent)
+    {
+        if (res.status != I2C_NACK_ADDR)
+            note(v_wrong_status, "wrong status", op, res, fired);
+    }
+    else if ((fired & (SIM_FAULT_NACK_ADDR | SIM_FAULT_NACK_DATA)) && !res.nacks_expected)
+    {
+        if (res.status == I2C_OK)
+        {
+            // only a retry may hide the NACK
+            if (!res.retried)
+                note(v_missed, "missed error", op, res, fired);
+            else if (!res.data_ok)
+                note(v_integrity, "integrity", op, res, fired);
+        }
+        else if (res.retried || res.status != ((fired & SIM_FAULT_NACK_DATA) ? I2C_NACK_DATA : I2C_NACK_ADDR))
+            note(v_wrong_status, "wrong status", op, res, fired);
+        // a NACKed write may have stored a part of the data
+        resync(res.target);
+    }
+    else if (res.status != I2C_OK)
+        note(v_spurious, "spurious error", op, res, fired);
+    else if (!res.data_ok)
+        note(v_integrity, "integrity", op, res, fired);
+    else
+        clean = true;
+
+    if (clean)
+    {
+        if (res.length)
+        {
+            for (uint16_t i = 0; i < res.length; i++)
+                shadow[res.target][(uint8_t)(res.reg + i)] = res.data[i];
+        }
+        for (uint8_t i = 0; i < SOAK_TARGETS; i++)
+        {
+            if (memcmp(shadow[i], targets[i]->mem, 256) != 0)
+            {
+                note(v_shadow, "shadow", op, res, fired);
+                resync(i);
+            }
+        }
+    }
+
+    // expected failures (nobody at the address) aren't bus errors
+    bool error = res.status != I2C_OK && !res.absent;
+    if (error)
+    {
+        failed++;
+        if (!failing)
+        {
+            failing = true;
+            fail_since = started;
+        }
+    }
+    else if (res.status == I2C_OK)
+    {
+        ok++;
+        bytes += res.bytes;
+        if (failing)
+        {
+            uint64_t recovery = sim.now - fail_since;
+            failing = false;
+            recoveries++;
+            recovery_sum += recovery;
+            if (recovery > recovery_max)
+                recovery_max = recovery;
+        }
+    }
+}
+
+void Soak::run()
+{
+    for (uint32_t n = 0; n < opt.ops; n++)
+    {
+        soak_result res;
+        memset(&res, 0, sizeof(res));
+        for (uint8_t i = 0; i < SOAK_TARGETS; i++)
+            targets[i]->disarm();
+
+        uint64_t started = sim.now;
+        SoakOp op = (SoakOp)rnd.range(0, OP_COUNT - 1);
+        op_counts[op]++;
+        switch (op)
+        {
+            case OP_WIRE_WRITE:     op_wire_write(res); break;
+            case OP_WIRE_READ:      op_wire_read(res); break;
+            case OP_READ_REGISTER:  op_read_register(res); break;
+            case OP_WRITE_REGISTER: op_write_register(res); break;
+            case OP_TRANSFER:       op_transfer(res); break;
+            case OP_UPDATE_BITS:    op_update_bits(res); break;
+            case OP_ASYNC:          op_async(res); break;
+            default:                op_scan(res); break;
+        }
+
+        // the library has to let go of the bus after every operation
+        if (!sim.masterReleased())
+        {
+            v_released++;
+            bus.stop();
+        }
+        sim.settle(SOAK_SETTLE_US);
+        if (!sim.idle())
+        {
+            bus_clear();
+            if (!sim.idle())
+                note(v_stuck, "bus stuck", op, res, 0);
+        }
+        evaluate(op, res, started);
+        // idle time between the operations
+        sim.advanceUs(rnd.range(0, 50));
+    }
+    // elastic timing keeps the minimum t_HIGH / t_LOW of the speed mode,
+    // also around interrupts and stretching
+    if (opt.elastic && sim.clocks && (sim.minHigh * 1000000000U < (uint64_t)high_ns * F_CPU ||
+                                      sim.minLow * 1000000000U < (uint64_t)low_ns * F_CPU))
+        v_timing++;
+    check_breaker();
+#if defined(SOFTWIRE_STATS)
+    check_estimate();
+#endif
+}
+
+bool Soak::passed() const
+{
+    return !(v_integrity || v_spurious || v_missed || v_wrong_status || v_busy || v_released || v_shadow || v_stuck || v_timing || v_estimate || v_stamps || v_breaker);
+}
+
+static void print_field(const char *name, uint64_t value, bool last = false)
+{
+    printf("\"%s\":%llu%s", name, (unsigned long long)value, last ? "" : ",");
+}
+
+void Soak::report(double wall_ms)
+{
+    double seconds = (double)sim.now / F_CPU;
+    printf("{\"variant\":\"%s\",", opt.variant);
+    print_field("seed", opt.seed);
+    print_field("ops", opt.ops);
+    print_field("clock_hz", opt.clock);
+    printf("\"elastic\":%s,", opt.elastic ? "true" : "false");
+    print_field("oversampling", opt.oversampling);
+    print_field("retries", opt.retries);
+    print_field("fault_per_mille", opt.faults);
+    print_field("jitter_per_mille", opt.jitter);
+    printf("\"sim_seconds\":%.3f,\"wall_ms\":%.0f,", seconds, wall_ms);
+    print_field("bytes", bytes);
+    print_field("throughput_bytes_per_s", seconds > 0 ? (uint64_t)(bytes / seconds) : 0);
+    print_field("ok", ok);
+    print_field("failed", failed);
+
+    printf("\"ops_by_type\":{");
+    for (uint8_t i = 0; i < OP_COUNT; i++)
+        print_field(op_names[i], op_counts[i], i == OP_COUNT - 1);
+    printf("},\"status\":{");
+    for (uint8_t i = 0; i <= I2C_BUSY; i++)
+        print_field(status_names[i], status_counts[i], i == I2C_BUSY);
+    printf("},\"faults_fired\":{");
+    for (uint8_t i = 0; i < 5; i++)
+        print_field(fault_names[i], fault_counts[i], i == 4);
+    printf("},\"recovery\":{");
+    print_field("count", recoveries);
+    print_field("avg_us", recoveries ? recovery_sum / recoveries / SIM_CYCLES_PER_US : 0);
+    print_field("max_us", recovery_max / SIM_CYCLES_PER_US, true);
+    printf("},\"scl\":{");
+    print_field("clocks", sim.clocks);
+    print_field("min_high_ns", sim.clocks ? sim.minHigh * 1000U / SIM_CYCLES_PER_US : 0);
+    print_field("min_low_ns", sim.clocks ? sim.minLow * 1000U / SIM_CYCLES_PER_US : 0, true);
+    printf("},\"cost_model\":{");
+    print_field("estimate_us", estimate_us);
+    print_field("actual_us", actual_us, true);
+    printf("},");
+    print_field("bus_clears", bus_clears);
+    print_field("undetected_corruptions", undetected);
+    printf("\"violations\":{");
+    print_field("integrity", v_integrity);
+    print_field("spurious_errors", v_spurious);
+    print_field("missed_errors", v_missed);
+    print_field("wrong_status", v_wrong_status);
+    print_field("busy", v_busy);
+    print_field("bus_not_released", v_released);
+    print_field("shadow", v_shadow);
+    print_field("bus_stuck", v_stuck);
+    print_field("scl_timing", v_timing);
+    print_field("estimate", v_estimate);
+    print_field("timestamps", v_stamps);
+    print_field("breaker", v_breaker, true);
+    printf("}");
+#if defined(SOFTWIRE_STATS)
+    printf(",\"library_stats\":");
+    fflush(stdout);
+    StdoutPrint out;
+    bus.printStats(out);
+#else
+    printf("\n");
+#endif
+    printf("}\n");
+}
+
+static bool parse_options(int argc, char **argv, soak_options &opt)
+{
+    opt.ops = 20000;
+    opt.seed = 1;
+    opt.clock = 100000;
+    opt.elastic = false;
+    opt.oversampling = 1;
+    opt.retries = 0;
+    opt.faults = 100;
+    opt.jitter = 1;
+    opt.verbose = false;
+    opt.variant = "default";
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (!strcmp(arg, "--elastic") || !strcmp(arg, "--verbose"))
+        {
+            (arg[2] == 'e' ? opt.elastic : opt.verbose) = true;
+            continue;
+        }
+        if (!value)
+            return false;
+        if (!strcmp(arg, "--ops"))
+            opt.ops = strtoul(value, nullptr, 0);
+        else if (!strcmp(arg, "--seed"))
+            opt.seed = strtoul(value, nullptr, 0);
+        else if (!strcmp(arg, "--clock"))
+            opt.clock = strtoul(value, nullptr, 0);
+        else if (!strcmp(arg, "--oversampling"))
+            opt.oversampling = strtoul(value, nullptr, 0);
+        else if (!strcmp(arg, "--retries"))
+            opt.retries = strtoul(value, nullptr, 0);
+        else if (!strcmp(arg, "--faults"))
+            opt.faults = strtoul(value, nullptr, 0);
+        else if (!strcmp(arg, "--jitter"))
+            opt.jitter = strtoul(value, nullptr, 0);
+        else if (!strcmp(arg, "--variant"))
+            opt.variant = value;
+        else
+            return false;
+        i++;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    soak_options opt;
+    if (!parse_options(argc, argv, opt))
+    {
+        fprintf(stderr, "usage: %s [--ops N] [--seed N] [--clock HZ] [--elastic] [--oversampling N]\n"
+                        "       [--retries N] [--faults PER_MILLE] [--jitter PER_MILLE] [--variant NAME] [--verbose]\n", argv[0]);
+        return 2;
+    }
+
+    sim.reset(opt.seed);
+    sim.jitterPerMille = opt.jitter;
+    sim.jitterMaxUs = 20;
+    SimTarget t0(target_addrs[0]), t1(target_addrs[1]), t2(target_addrs[2]), t3(target_addrs[3]);
+    SimTarget *targets[SOAK_TARGETS] = { &t0, &t1, &t2, &t3 };
+    for (uint8_t i = 0; i < SOAK_TARGETS; i++)
+        sim.attach(*targets[i]);
+
+    SoftWire bus(SDA, SCL);
+    bus.begin();
+    bus.setClock(opt.clock);
+    if (opt.elastic)
+        bus.setElasticTiming(true);
+    bus.setOversampling(opt.oversampling);
+    bus.setRetryPolicy(opt.retries);
+
+    Soak soak(bus, bus, targets, opt);
+    clock_t t = clock();
+    soak.run();
+    soak.report((double)(clock() - t) * 1000.0 / CLOCKS_PER_SEC);
+    return soak.passed() ? 0 : 1;
+}
@@ -0,0 +1,160 @@
+/**
+ * @file Arduino.h
+ * @brief Minimal host stand-in for the Arduino Core STM32, just enough to
+ *        build the library against the simulated bus of the soak test.
+ */
+
+/*
+ * Pins, time and the GPIO/DWT registers used by SoftWire are routed to the
+ * simulator (see SimBus.h). Every pin access and every delay advances the
+ * simulated time, so the library sees a bus running at a realistic speed.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <functional>
+
+#define STM32_CORE_VERSION      0x02030000
+#define F_CPU                   72000000UL
+
+#define WEAK                    __attribute__((weak))
+#define UNUSED(x)               (void)(x)
+
+#define LOW                     0x0
+#define HIGH                    0x1
+
+#define INPUT                   0x0
+#define OUTPUT                  0x1
+#define INPUT_PULLUP            0x2
+#define OUTPUT_OPEN_DRAIN       0x4
+
+#define CHANGE                  2
+#define FALLING                 3
+#define RISING                  4
+
+// PinName as in the STM32 core: port in the upper, pin in the lower nibble
+typedef enum : int32_t {
+    NC = -1
+} PinName;
+
+#define STM_PORT(X)             ((((uint32_t)(X)) >> 4) & 0xF)
+#define STM_PIN(X)              (((uint32_t)(X)) & 0xF)
+#define STM_GPIO_PIN(X)         ((uint16_t)(1U << STM_PIN(X)))
+// encoded like LL_GPIO_PIN_x on the STM32F1 (BSRR bit, CRL/CRH selector),
+// i.e. not usable as a plain register mask
+#define STM_LL_GPIO_PIN(X)      ((((uint32_t)STM_GPIO_PIN(X)) << 8) | \
+                                 (1U << (STM_PIN(X) & 7)) | (STM_PIN(X) >= 8 ? 0x04000000U : 0U))
+
+#define PA0     0x00
+#define PA1     0x01
+#define PA2     0x02
+#define PA3     0x03
+#define PB6     0x16
+#define PB7     0x17
+#define PC13    0x2D
+#define PC14    0x2E
+
+#define SDA     PB7
+#define SCL     PB6
+
+inline PinName digitalPinToPinName(uint32_t pin) { return (PinName)pin; }
+
+void pinMode(uint32_t pin, uint32_t mode);
+void digitalWriteFast(PinName pin, uint32_t value);
+int digitalReadFast(PinName pin);
+inline void digitalWrite(uint32_t pin, uint32_t value) { digitalWriteFast((PinName)pin, value); }
+inline int digitalRead(uint32_t pin) { return digitalReadFast((PinName)pin); }
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+void attachInterrupt(uint32_t pin, std::function<void(void)> callback, uint32_t mode);
+void detachInterrupt(uint32_t pin);
+
+/*
+ * GPIO registers: IDR reads the simulated line levels, BSRR drives them
+ */
+struct SimGpioIDR {
+    uint8_t port;
+    operator uint32_t() const;
+};
+
+struct SimGpioBSRR {
+    uint8_t port;
+    SimGpioBSRR &operator=(uint32_t value);
+};
+
+typedef struct {
+    SimGpioIDR IDR;
+    SimGpioBSRR BSRR;
+} GPIO_TypeDef;
+
+GPIO_TypeDef *get_GPIO_Port(uint32_t port);
+
+/*
+ * DWT cycle counter, derived from the simulated time
+ */
+struct SimCycleCounter {
+    operator uint32_t() const;
+};
+
+struct SimDWT {
+    SimCycleCounter CYCCNT;
+    uint32_t CTRL;
+};
+
+struct SimCoreDebug {
+    uint32_t DEMCR;
+};
+
+extern SimDWT sim_dwt;
+extern SimCoreDebug sim_core_debug;
+
+/*
+ * Core registers: nothing preempts the soak test, so masking interrupts
+ * has nothing to keep out. The test sets sim_ipsr to call the library
+ * like an interrupt handler would.
+ */
+extern uint32_t sim_ipsr;
+inline uint32_t __get_IPSR() { return sim_ipsr; }
+inline uint32_t __get_PRIMASK() { return 0; }
+inline void __set_PRIMASK(uint32_t primask) { UNUSED(primask); }
+inline void __disable_irq() {}
+
+#define __CORTEX_M                      3
+#define DWT                             (&sim_dwt)
+#define CoreDebug                       (&sim_core_debug)
+#define DWT_CTRL_CYCCNTENA_Msk          (1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk      (1UL << 24)
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t value) = 0;
+    virtual size_t write(const uint8_t *buf, size_t len)
+    {
+        size_t n = 0;
+        while (len--)
+            n += write(*buf++);
+        return n;
+    }
+    size_t write(const char *str) { return write((const uint8_t*)str, strlen(str)); }
+
+    size_t print(const char *str) { return write(str); }
+    size_t print(unsigned long value);
+    size_t println(const char *str) { return print(str) + print("\n"); }
+    size_t println() { return print("\n"); }
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    virtual void flush() {}
+};
@@ -0,0 +1,19 @@
+/**
+ * @file Wire.h
+ * @brief Host stand-in for the Wire library of the Arduino Core STM32,
+ *        providing the status codes and buffer size SoftWire builds on.
+ */
+
+#pragma once
+
+#define I2C_TXRX_BUFFER_SIZE    32
+
+typedef enum {
+    I2C_OK = 0,
+    I2C_DATA_TOO_LONG = 1,
+    I2C_NACK_ADDR = 2,
+    I2C_NACK_DATA = 3,
+    I2C_ERROR = 4,
+    I2C_TIMEOUT = 5,
+    I2C_BUSY = 6
+} i2c_status_e;